@@ -0,0 +1,281 @@
+/*
+ * This file is part of the dtlog library, originally created by Tynes0.
+ * For the latest version and updates, please visit the official dtlog GitHub repository:
+ * https://github.com/tynes0/dtlog
+ *
+ * dtlog is a basic library for logging, providing fast and user-friendly use
+ * It is released under the Apache License 2.0. See the LICENSE file in the root of the dtlog repository
+ * or visit the above GitHub link for more details.
+ *
+ * For contributions, bug reports, or other inquiries, feel free to contact the author:
+ * - GitHub: https://github.com/tynes0
+ * - Email: cihanbilgihan@gmail.com
+ */
+
+
+#pragma once
+
+#include <algorithm>   // @brief Include for std::sort.
+#include <chrono>      // @brief Include for std::chrono::steady_clock.
+#include <cstdint>     // @brief Include for std::uint64_t.
+#include <cstdio>      // @brief Include for std::fprintf.
+#include <cstring>     // @brief Include for std::strstr.
+#include <string>      // @brief Include for std::string.
+#include <vector>      // @brief Include for std::vector.
+
+#if defined(_MSC_VER)
+#include <intrin.h>    // @brief Include for _ReadWriteBarrier and __rdtsc.
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // @brief Include for __rdtsc.
+#endif // _MSC_VER
+
+/**
+ * @brief A small self-contained benchmark harness.
+ *
+ * Every benchmark is a callable run in a loop. The iteration count is doubled until one run takes at least
+ * min_run_time, then the loop is repeated repetitions times and the median time per iteration is reported.
+ */
+namespace bench
+{
+    constexpr std::chrono::milliseconds min_run_time(25); ///< The minimum duration of one measured run.
+    constexpr int repetitions = 7;                         ///< The number of measured runs per benchmark.
+
+    /**
+     * @brief Keeps the compiler from optimizing a value away.
+     * @tparam _Ty The type of the value.
+     * @param value The value.
+     */
+    template <class _Ty>
+    inline void do_not_optimize(const _Ty& value)
+    {
+#if defined(_MSC_VER)
+        const volatile char* volatile sink = reinterpret_cast<const volatile char*>(&value);
+        (void)sink;
+        _ReadWriteBarrier();
+#else // _MSC_VER
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif // _MSC_VER
+    }
+
+    /**
+     * @brief Holds the options given on the command line.
+     */
+    struct options
+    {
+        const char* filter = nullptr; ///< Only benchmarks whose name contains this text are run.
+        FILE* report = stderr;        ///< The stream results are written to.
+    };
+
+    /**
+     * @brief Gets the options of the process.
+     * @return The options.
+     */
+    inline options& get_options()
+    {
+        static options instance;
+        return instance;
+    }
+
+    /**
+     * @brief Reads the command line: an optional name filter.
+     * @param argc The argument count.
+     * @param argv The arguments.
+     */
+    inline void parse_options(int argc, char** argv)
+    {
+        if (argc > 1)
+            get_options().filter = argv[1];
+    }
+
+    /**
+     * @brief Prints the heading of a group of benchmarks.
+     * @param name The name of the group.
+     */
+    inline void section(const char* name)
+    {
+        std::fprintf(get_options().report, "\n== %s ==\n", name);
+    }
+
+    /**
+     * @brief Runs a callable iterations times.
+     * @tparam _Fn The type of the callable.
+     * @param fn The callable.
+     * @param iterations The number of calls.
+     * @return The elapsed time in nanoseconds.
+     */
+    template <class _Fn>
+    double time_loop(_Fn& fn, size_t iterations)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+            fn();
+        const auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(stop - start).count();
+    }
+
+    /**
+     * @brief Measures a callable and prints the median time per call.
+     * @tparam _Fn The type of the callable.
+     * @param name The name of the benchmark.
+     * @param fn The callable.
+     */
+    template <class _Fn>
+    void run(const char* name, _Fn fn)
+    {
+        const options& opts = get_options();
+        if (opts.filter && !std::strstr(name, opts.filter))
+            return;
+
+        size_t iterations = 1;
+        const double min_ns = std::chrono::duration<double, std::nano>(min_run_time).count();
+        while (time_loop(fn, iterations) < min_ns && iterations < (size_t(1) << 40))
+            iterations *= 2;
+
+        std::vector<double> samples;
+        for (int i = 0; i < repetitions; ++i)
+            samples.push_back(time_loop(fn, iterations) / static_cast<double>(iterations));
+        std::sort(samples.begin(), samples.end());
+
+        std::fprintf(opts.report, "%-52s %10.1f ns/op  (min %.1f, %zu iterations)\n", name, samples[samples.size() / 2], samples.front(), iterations);
+        std::fflush(opts.report);
+    }
+
+    /**
+     * @brief Reads a cheap monotonic tick counter: the time stamp counter on x86, steady_clock nanoseconds elsewhere.
+     * @return The current tick.
+     */
+    inline std::uint64_t ticks()
+    {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else // x86
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif // x86
+    }
+
+    /**
+     * @brief Measures how many nanoseconds one tick of ticks() takes.
+     * @return The length of one tick in nanoseconds.
+     */
+    inline double nanoseconds_per_tick()
+    {
+        static const double value = [] {
+            const auto start_time = std::chrono::steady_clock::now();
+            const std::uint64_t start_ticks = ticks();
+            while (std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(50))
+                ;
+            const std::uint64_t stop_ticks = ticks();
+            const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count();
+            return stop_ticks > start_ticks ? elapsed / static_cast<double>(stop_ticks - start_ticks) : 1.0;
+        }();
+        return value;
+    }
+
+    /**
+     * @brief A log-linear latency histogram in the style of HdrHistogram.
+     *
+     * Values below sub_bucket_count have a bucket each. Above that, every power of two is split into
+     * sub_bucket_count / 2 buckets, so a recorded value is off by less than 1/64 of itself.
+     */
+    class histogram
+    {
+    public:
+        static constexpr std::uint64_t sub_bucket_count = 128;                              ///< The number of buckets below the first power of two split.
+        static constexpr std::uint64_t half_count = sub_bucket_count / 2;                   ///< The number of buckets per power of two above that.
+        static constexpr size_t bucket_count = sub_bucket_count + (64 - 7) * half_count;    ///< The total number of buckets.
+
+        histogram() : m_buckets(bucket_count, 0) {}
+
+        /**
+         * @brief Records one value.
+         * @param value The value.
+         */
+        void record(std::uint64_t value)
+        {
+            ++m_buckets[index_of(value)];
+            ++m_count;
+            if (value > m_max)
+                m_max = value;
+        }
+
+        /**
+         * @brief Adds the values recorded by another histogram.
+         * @param other The other histogram.
+         */
+        void merge(const histogram& other)
+        {
+            for (size_t i = 0; i < bucket_count; ++i)
+                m_buckets[i] += other.m_buckets[i];
+            m_count += other.m_count;
+            if (other.m_max > m_max)
+                m_max = other.m_max;
+        }
+
+        /**
+         * @brief Gets the number of recorded values.
+         * @return The count.
+         */
+        std::uint64_t count() const
+        {
+            return m_count;
+        }
+
+        /**
+         * @brief Gets the largest recorded value.
+         * @return The maximum.
+         */
+        std::uint64_t max() const
+        {
+            return m_max;
+        }
+
+        /**
+         * @brief Gets the value below which the given fraction of the recorded values lies.
+         * @param fraction The fraction, between 0 and 1.
+         * @return The highest value of the bucket that holds the percentile, at most max().
+         */
+        std::uint64_t percentile(double fraction) const
+        {
+            if (m_count == 0)
+                return 0;
+            std::uint64_t rank = static_cast<std::uint64_t>(fraction * static_cast<double>(m_count) + 0.5);
+            if (rank == 0)
+                rank = 1;
+            std::uint64_t seen = 0;
+            for (size_t i = 0; i < bucket_count; ++i)
+            {
+                seen += m_buckets[i];
+                if (seen >= rank)
+                    return std::min(highest_of(i), m_max);
+            }
+            return m_max;
+        }
+
+    private:
+        static size_t index_of(std::uint64_t value)
+        {
+            if (value < sub_bucket_count)
+                return static_cast<size_t>(value);
+            int msb = 63;
+            while (!(value >> msb))
+                --msb;
+            const int shift = msb - 6;
+            return static_cast<size_t>(sub_bucket_count + (shift - 1) * half_count + ((value >> shift) - half_count));
+        }
+
+        static std::uint64_t highest_of(size_t index)
+        {
+            if (index < sub_bucket_count)
+                return index;
+            const std::uint64_t shift = (index - sub_bucket_count) / half_count + 1;
+            const std::uint64_t sub = (index - sub_bucket_count) % half_count + half_count;
+            return ((sub + 1) << shift) - 1;
+        }
+
+        std::vector<std::uint64_t> m_buckets; ///< The number of values per bucket.
+        std::uint64_t m_count = 0;            ///< The number of recorded values.
+        std::uint64_t m_max = 0;              ///< The largest recorded value.
+    };
+} // namespace bench
@@ -0,0 +1,284 @@
+/*
+ * This file is part of the dtlog library, originally created by Tynes0.
+ * For the latest version and updates, please visit the official dtlog GitHub repository:
+ * https://github.com/tynes0/dtlog
+ *
+ * dtlog is a basic library for logging, providing fast and user-friendly use
+ * It is released under the Apache License 2.0. See the LICENSE file in the root of the dtlog repository
+ * or visit the above GitHub link for more details.
+ *
+ * For contributions, bug reports, or other inquiries, feel free to contact the author:
+ * - GitHub: https://github.com/tynes0
+ * - Email: cihanbilgihan@gmail.com
+ */
+
+
+#include "bench.h"
+#include "dtlog.h"
+
+#include <ctime>      // @brief Include for std::strftime.
+#include <sstream>    // @brief Include for std::ostringstream.
+
+namespace
+{
+    /**
+     * @brief A fixed point in time, so every date and time benchmark formats the same values.
+     * @return The time.
+     */
+    std::tm sample_time()
+    {
+        std::tm time{};
+        time.tm_year = 124;
+        time.tm_mon = 10;
+        time.tm_mday = 7;
+        time.tm_wday = 4;
+        time.tm_hour = 14;
+        time.tm_min = 5;
+        time.tm_sec = 9;
+        return time;
+    }
+
+    void bench_formatter()
+    {
+        bench::section("formatter");
+        const std::string user = "alice";
+        const std::vector<int> ids{ 1, 2, 3, 4, 5, 6, 7, 8 };
+
+        bench::run("format: no arguments", [] {
+            bench::do_not_optimize(dtlog::formatter::format("connection established"));
+        });
+        bench::run("format: one int", [] {
+            bench::do_not_optimize(dtlog::formatter::format("value {0}", 42));
+        });
+        bench::run("format: string, int, double, bool", [&] {
+            bench::do_not_optimize(dtlog::formatter::format("user {0} id {1} ratio {2} ok {3}", user, 1234, 0.75, true));
+        });
+        bench::run("format: six ints", [] {
+            bench::do_not_optimize(dtlog::formatter::format("{0} {1} {2} {3} {4} {5}", 1, -22, 333, -4444, 55555, -666666));
+        });
+        bench::run("format: vector<int> (8 elements)", [&] {
+            bench::do_not_optimize(dtlog::formatter::format("ids {0}", ids));
+        });
+
+        dtlog::format_buffer buffer;
+        bench::run("format_to: string, int, double, bool", [&] {
+            buffer.clear();
+            dtlog::formatter::format_to(buffer, "user {0} id {1} ratio {2} ok {3}", user, 1234, 0.75, true);
+            bench::do_not_optimize(buffer.data());
+        });
+        bench::run("printf_to: string, int, double, bool", [&] {
+            buffer.clear();
+            dtlog::formatter::printf_to(buffer, "user %s id %d ratio %g ok %d", user, 1234, 0.75, true);
+            bench::do_not_optimize(buffer.data());
+        });
+
+        char text[256];
+        bench::run("baseline snprintf: string, int, double, bool", [&] {
+            std::snprintf(text, sizeof(text), "user %s id %d ratio %g ok %d", user.c_str(), 1234, 0.75, 1);
+            bench::do_not_optimize(text);
+        });
+        bench::run("baseline snprintf: six ints", [&] {
+            std::snprintf(text, sizeof(text), "%d %d %d %d %d %d", 1, -22, 333, -4444, 55555, -666666);
+            bench::do_not_optimize(text);
+        });
+        bench::run("baseline ostringstream: string, int, double, bool", [&] {
+            std::ostringstream oss;
+            oss << "user " << user << " id " << 1234 << " ratio " << 0.75 << " ok " << true;
+            bench::do_not_optimize(oss.str());
+        });
+    }
+
+    void bench_date_time_formatter()
+    {
+        bench::section("date_time_formatter");
+        const std::tm time = sample_time();
+        const dtlog::date_time_formatter formatter(&time);
+
+#define DTLOG_BENCH_TIME_METHOD(method) \
+        bench::run("date_time_formatter::" #method, [&] { bench::do_not_optimize(formatter.method()); })
+
+        DTLOG_BENCH_TIME_METHOD(full_weekday_name);
+        DTLOG_BENCH_TIME_METHOD(full_month_name);
+        DTLOG_BENCH_TIME_METHOD(year_2_digits);
+        DTLOG_BENCH_TIME_METHOD(year_4_digits);
+        DTLOG_BENCH_TIME_METHOD(date_time_representation);
+        DTLOG_BENCH_TIME_METHOD(short_MMDDYY_date);
+        DTLOG_BENCH_TIME_METHOD(month);
+        DTLOG_BENCH_TIME_METHOD(day_of_month);
+        DTLOG_BENCH_TIME_METHOD(hours_24_format);
+        DTLOG_BENCH_TIME_METHOD(hours_12_format);
+        DTLOG_BENCH_TIME_METHOD(minutes);
+        DTLOG_BENCH_TIME_METHOD(seconds);
+        DTLOG_BENCH_TIME_METHOD(AM_PM);
+        DTLOG_BENCH_TIME_METHOD(clock_12_hour);
+        DTLOG_BENCH_TIME_METHOD(HHMM_time_24_hour);
+        DTLOG_BENCH_TIME_METHOD(ISO8601_time_format);
+#undef DTLOG_BENCH_TIME_METHOD
+
+        dtlog::format_buffer buffer;
+        bench::run("date_time_formatter::append_token('R')", [&] {
+            buffer.clear();
+            formatter.append_token(buffer, 'R');
+            bench::do_not_optimize(buffer.data());
+        });
+        bench::run("date_time_formatter::reset_time", [] {
+            dtlog::date_time_formatter current;
+            bench::do_not_optimize(current);
+        });
+        bench::run("date_time_formatter(time_t): same second (cached)", [] {
+            dtlog::date_time_formatter current(static_cast<std::time_t>(1700000000));
+            bench::do_not_optimize(current);
+        });
+        std::time_t seconds = 1700000000;
+        bench::run("date_time_formatter(time_t): new second", [&] {
+            dtlog::date_time_formatter current(++seconds);
+            bench::do_not_optimize(current);
+        });
+
+        dtlog::real_clock real;
+        dtlog::coarse_clock coarse;
+        bench::run("real_clock::now", [&] { bench::do_not_optimize(real.now()); });
+        bench::run("coarse_clock::now", [&] { bench::do_not_optimize(coarse.now()); });
+
+        char text[128];
+        bench::run("baseline strftime: %A %B %d %Y %H:%M:%S", [&] {
+            std::strftime(text, sizeof(text), "%A %B %d %Y %H:%M:%S", &time);
+            bench::do_not_optimize(text);
+        });
+    }
+
+    void bench_pattern()
+    {
+        bench::section("pattern");
+        // A manual clock keeps the time out of the measurements; the last benchmarks add each clock back.
+        dtlog::manual_clock fixed_clock(1700000000);
+        dtlog::real_clock real;
+        dtlog::coarse_clock coarse;
+        dtlog::logger default_logger("bench");
+        dtlog::logger complex_logger("bench", "%A %B %d %Y %T [%p] %N (%l): %V%n");
+        default_logger.set_clock(&fixed_clock);
+        complex_logger.set_clock(&fixed_clock);
+        dtlog::format_buffer buffer;
+        const std::string_view message = "request served in 12 ms";
+
+        bench::run("pattern: default \"[%R] %N: %V\"", [&] {
+            buffer.clear();
+            default_logger.format_record(dtlog::log_level::info, message, buffer);
+            bench::do_not_optimize(buffer.data());
+        });
+        bench::run("pattern: \"%A %B %d %Y %T [%p] %N (%l): %V%n\"", [&] {
+            buffer.clear();
+            complex_logger.format_record(dtlog::log_level::info, message, buffer);
+            bench::do_not_optimize(buffer.data());
+        });
+        default_logger.set_clock(&real);
+        bench::run("pattern: default, real_clock", [&] {
+            buffer.clear();
+            default_logger.format_record(dtlog::log_level::info, message, buffer);
+            bench::do_not_optimize(buffer.data());
+        });
+        default_logger.set_clock(&coarse);
+        bench::run("pattern: default, coarse_clock", [&] {
+            buffer.clear();
+            default_logger.format_record(dtlog::log_level::info, message, buffer);
+            bench::do_not_optimize(buffer.data());
+        });
+        std::time_t seconds = 1700000000;
+        default_logger.set_clock(&fixed_clock);
+        bench::run("pattern: default, new second every record", [&] {
+            fixed_clock.set(++seconds);
+            buffer.clear();
+            default_logger.format_record(dtlog::log_level::info, message, buffer);
+            bench::do_not_optimize(buffer.data());
+        });
+
+        char text[256];
+        bench::run("baseline time+localtime+strftime+snprintf", [&] {
+            const std::time_t now = std::time(nullptr);
+            char date[64];
+            std::strftime(date, sizeof(date), "%A %B %d %Y %H:%M:%S", std::localtime(&now));
+            std::snprintf(text, sizeof(text), "[%s] %s: %.*s", date, "bench", static_cast<int>(message.size()), message.data());
+            bench::do_not_optimize(text);
+        });
+    }
+
+    void bench_log(const char* null_device, const char* file_path)
+    {
+        bench::section("log");
+        dtlog::logger log("bench", "[%T] %N: %V%n");
+        int counter = 0;
+
+        // stdout is redirected to /dev/null by main().
+        bench::run("log(): stdout (/dev/null)", [&] {
+            log.info("request {0} served in {1} ms", ++counter, 12.5);
+        });
+        bench::run("log_multiline(): 3 lines, stdout (/dev/null)", [&] {
+            log.log_multiline(dtlog::log_level::info, "first {0}\nsecond\nthird", ++counter);
+        });
+        bench::run("scoped_timer: below threshold (not logged)", [&] {
+            dtlog::scoped_timer timer(log, std::chrono::seconds(1), "request {0}", ++counter);
+        });
+        bench::run("scoped_timer: logged, stdout (/dev/null)", [&] {
+            dtlog::scoped_timer timer(log, "request {0}", ++counter);
+        });
+        {
+            dtlog::trace_sink trace(null_device);
+            log.set_trace_sink(&trace);
+            bench::run("scoped_timer: traced, below threshold", [&] {
+                dtlog::scoped_timer timer(log, std::chrono::seconds(1), "request {0}", ++counter);
+            });
+            log.set_trace_sink(nullptr);
+        }
+        bench::run("baseline fprintf+fflush: stdout (/dev/null)", [&] {
+            std::fprintf(stdout, "[%02d:%02d:%02d] %s: request %d served in %g ms\n", 14, 5, 9, "bench", ++counter, 12.5);
+            std::fflush(stdout);
+        });
+
+        FILE* file = std::fopen(file_path, "w");
+        if (!file)
+        {
+            std::fprintf(bench::get_options().report, "cannot open %s, skipping the file benchmarks\n", file_path);
+            return;
+        }
+        bench::run("log_to_file(FILE*): message only", [&] {
+            log.log_to_file(file, "request {0} served in {1} ms\n", ++counter, 12.5);
+        });
+        bench::run("record_stream: pattern + message to file", [&] {
+            dtlog::logger::record_stream(log, dtlog::log_level::info, file) << "request " << ++counter << " served in " << 12.5 << " ms";
+        });
+        bench::run("batch: 100 records to file (per batch)", [&] {
+            dtlog::logger::batch records(log, file);
+            for (int i = 0; i < 100; ++i)
+                records.info("request {0} served in {1} ms", ++counter, 12.5);
+        });
+        bench::run("baseline fprintf+fflush: file", [&] {
+            std::fprintf(file, "[%02d:%02d:%02d] %s: request %d served in %g ms\n", 14, 5, 9, "bench", ++counter, 12.5);
+            std::fflush(file);
+        });
+        std::fclose(file);
+        std::remove(file_path);
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bench::parse_options(argc, argv);
+#ifdef _WIN32
+    const char* null_device = "NUL";
+#else // _WIN32
+    const char* null_device = "/dev/null";
+#endif // _WIN32
+    if (!std::freopen(null_device, "w", stdout))
+        return 1;
+
+#if DTLOG_USE_STD_FORMAT
+    std::fprintf(bench::get_options().report, "dtlog benchmarks (std::format backend)\n");
+#else // DTLOG_USE_STD_FORMAT
+    std::fprintf(bench::get_options().report, "dtlog benchmarks\n");
+#endif // DTLOG_USE_STD_FORMAT
+    bench_formatter();
+    bench_date_time_formatter();
+    bench_pattern();
+    bench_log(null_device, "dtlog_bench.log");
+    return 0;
+}
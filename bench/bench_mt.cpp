@@ -0,0 +1,230 @@
+/*
+ * This file is part of the dtlog library, originally created by Tynes0.
+ * For the latest version and updates, please visit the official dtlog GitHub repository:
+ * https://github.com/tynes0/dtlog
+ *
+ * dtlog is a basic library for logging, providing fast and user-friendly use
+ * It is released under the Apache License 2.0. See the LICENSE file in the root of the dtlog repository
+ * or visit the above GitHub link for more details.
+ *
+ * For contributions, bug reports, or other inquiries, feel free to contact the author:
+ * - GitHub: https://github.com/tynes0
+ * - Email: cihanbilgihan@gmail.com
+ */
+
+
+#include "bench.h"
+#include "dtlog.h"
+
+#include <atomic>     // @brief Include for std::atomic.
+#include <cstdlib>    // @brief Include for std::strtoul.
+#include <thread>     // @brief Include for std::thread.
+
+namespace
+{
+#ifdef _WIN32
+    constexpr const char* null_device = "NUL";
+#else // _WIN32
+    constexpr const char* null_device = "/dev/null";
+#endif // _WIN32
+    constexpr const char* log_file = "dtlog_bench_mt.log";
+
+    /**
+     * @brief Where the records of one run go.
+     */
+    enum class sink
+    {
+        stdout_null, ///< log() with stdout redirected to the null device, flushed per record.
+        file,        ///< log() with stdout redirected to a file, flushed per record.
+        null         ///< format_record() only: the full record is built but never written.
+    };
+
+    /**
+     * @brief Gets the name of a sink.
+     * @param target The sink.
+     * @return The name.
+     */
+    const char* sink_name(sink target)
+    {
+        switch (target)
+        {
+        case sink::stdout_null: return "stdout (/dev/null)";
+        case sink::file:        return "file";
+        case sink::null:        return "null";
+        }
+        return "";
+    }
+
+    /**
+     * @brief Points stdout at the device or file the sink writes to.
+     * @param target The sink.
+     * @return True on success.
+     */
+    bool open_sink(sink target)
+    {
+        return std::freopen(target == sink::file ? log_file : null_device, "w", stdout) != nullptr;
+    }
+
+    /**
+     * @brief Prints the stage histograms collected since the last call and empties them.
+     * @param report The stream to print to.
+     * @param ns_per_tick The length of one tick in nanoseconds.
+     */
+    void report_stages(FILE* report, double ns_per_tick)
+    {
+#if DTLOG_INSTRUMENT_STAGES
+        std::fprintf(report, "%9s %14s %10s %10s %10s %12s\n", "stage", "count", "mean ns", "p50 ns", "p99 ns", "max ns");
+        for (size_t i = 0; i < dtlog::stage_count; ++i)
+        {
+            const dtlog::stage value = static_cast<dtlog::stage>(i);
+            const dtlog::stage_stats stats = dtlog::get_stage_stats(value);
+            std::fprintf(report, "%9s %14llu %10.0f %10.0f %10.0f %12.0f\n", std::string(dtlog::stage_name(value)).c_str(),
+                static_cast<unsigned long long>(stats.count), stats.mean_ticks() * ns_per_tick,
+                static_cast<double>(stats.percentile(0.5)) * ns_per_tick, static_cast<double>(stats.percentile(0.99)) * ns_per_tick,
+                static_cast<double>(stats.max_ticks) * ns_per_tick);
+        }
+#else // DTLOG_INSTRUMENT_STAGES
+        (void)report;
+        (void)ns_per_tick;
+#endif // DTLOG_INSTRUMENT_STAGES
+        dtlog::reset_stage_stats();
+    }
+
+    /**
+     * @brief Gets the producer counts to run: the powers of two below max_producers, then max_producers.
+     * @param max_producers The largest number of producer threads.
+     * @return The counts.
+     */
+    std::vector<unsigned> producer_counts(unsigned max_producers)
+    {
+        std::vector<unsigned> counts;
+        for (unsigned producers = 1; producers < max_producers; producers *= 2)
+            counts.push_back(producers);
+        counts.push_back(max_producers);
+        return counts;
+    }
+
+    /**
+     * @brief The result of one run.
+     */
+    struct result
+    {
+        bench::histogram latency;   ///< The latency of every call, in ticks.
+        double seconds = 0.0;       ///< The wall time from the start signal until the last producer finished.
+    };
+
+    /**
+     * @brief Starts producer threads that each log the given number of records through one logger.
+     * @param target The sink.
+     * @param producers The number of producer threads.
+     * @param records The number of records per thread.
+     * @return The merged latency histogram and the wall time.
+     */
+    result run(sink target, unsigned producers, unsigned long records)
+    {
+        dtlog::logger log("bench_mt", "[%T] [%p] %N: %V%n");
+        std::vector<bench::histogram> latencies(producers);
+        std::vector<std::thread> threads;
+        std::atomic<unsigned> ready{ 0 };
+        std::atomic<bool> start{ false };
+
+        for (unsigned id = 0; id < producers; ++id)
+        {
+            threads.emplace_back([&, id] {
+                dtlog::preallocate_thread();
+                dtlog::format_buffer message;
+                dtlog::format_buffer record;
+                message.reserve(1024);
+                record.reserve(4096);
+                bench::histogram& latency = latencies[id];
+
+                ready.fetch_add(1);
+                while (!start.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+
+                for (unsigned long i = 0; i < records; ++i)
+                {
+                    const std::uint64_t begin = bench::ticks();
+                    if (target == sink::null)
+                    {
+                        message.clear();
+                        record.clear();
+                        dtlog::formatter::format_to(message, "producer {0} record {1} value {2}", id, i, 3.25);
+                        log.format_record(dtlog::log_level::info, std::string_view(message.data(), message.size()), record);
+                        bench::do_not_optimize(record.data());
+                    }
+                    else
+                    {
+                        log.info("producer {0} record {1} value {2}", id, i, 3.25);
+                    }
+                    latency.record(bench::ticks() - begin);
+                }
+            });
+        }
+
+        while (ready.load() != producers)
+            std::this_thread::yield();
+        const auto begin = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        for (std::thread& thread : threads)
+            thread.join();
+        const auto end = std::chrono::steady_clock::now();
+
+        result out;
+        out.seconds = std::chrono::duration<double>(end - begin).count();
+        for (const bench::histogram& latency : latencies)
+            out.latency.merge(latency);
+        return out;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned max_producers = std::thread::hardware_concurrency();
+    if (max_producers == 0)
+        max_producers = 4;
+    unsigned long records = 200000;
+    if (argc > 1)
+        max_producers = static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10));
+    if (argc > 2)
+        records = std::strtoul(argv[2], nullptr, 10);
+    if (max_producers == 0 || records == 0)
+    {
+        std::fprintf(stderr, "usage: %s [max producer threads] [records per thread]\n", argv[0]);
+        return 1;
+    }
+
+    dtlog::preallocate();
+    const double ns_per_tick = bench::nanoseconds_per_tick();
+    FILE* report = stderr;
+    std::fprintf(report, "dtlog multi-threaded benchmark: up to %u producers, %lu records each, %.3f ns per tick\n",
+        max_producers, records, ns_per_tick);
+    std::fprintf(report, "backend lag: n/a (records are written synchronously by the calling thread)\n");
+
+    for (sink target : { sink::stdout_null, sink::file, sink::null })
+    {
+        std::fprintf(report, "\n== %s ==\n", sink_name(target));
+        dtlog::reset_stage_stats();
+        std::fprintf(report, "%9s %14s %10s %10s %10s %12s\n", "producers", "records/s", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+        for (unsigned producers : producer_counts(max_producers))
+        {
+            if (!open_sink(target))
+            {
+                std::fprintf(report, "cannot open the sink, skipping\n");
+                break;
+            }
+            const result out = run(target, producers, records);
+            const auto ns = [&](std::uint64_t value) { return static_cast<double>(value) * ns_per_tick; };
+            std::fprintf(report, "%9u %14.0f %10.0f %10.0f %10.0f %12.0f\n", producers,
+                static_cast<double>(out.latency.count()) / out.seconds,
+                ns(out.latency.percentile(0.5)), ns(out.latency.percentile(0.99)),
+                ns(out.latency.percentile(0.999)), ns(out.latency.max()));
+            std::fflush(report);
+        }
+        report_stages(report, ns_per_tick);
+    }
+
+    std::freopen(null_device, "w", stdout);
+    std::remove(log_file);
+    return 0;
+}
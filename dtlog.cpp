@@ -93,64 +93,167 @@ void dtlog::logger::set_stderr_color(log_level level)
 
 void dtlog::logger::set_stdout_color(log_level level)
 {
-	const char* color_code = "\x1b[0m";
+	const std::string_view color_code = log_level_ansi_color(level);
+	fwrite(color_code.data(), sizeof(char), color_code.size(), stdout);
+}
 
-	switch (level)
+void dtlog::logger::set_stderr_color(log_level level)
+{
+	const std::string_view color_code = log_level_ansi_color(level);
+	fwrite(color_code.data(), sizeof(char), color_code.size(), stderr);
+}
+
+#endif // _WIN32
+
+#ifdef _WIN32
+
+void* dtlog::page_resource::do_allocate(size_t bytes, size_t alignment)
+{
+	SYSTEM_INFO system_info;
+	GetSystemInfo(&system_info);
+	const size_t page_size = system_info.dwPageSize;
+	if (alignment > page_size)
+		throw std::bad_alloc();
+	if (bytes == 0)
+		bytes = 1;
+
+	const bool huge = m_huge_pages && bytes >= huge_page_size;
+	bool fell_back = false;
+	bool large = false;
+	void* ptr = nullptr;
+	size_t length = (bytes + page_size - 1) / page_size * page_size;
+	if (huge)
 	{
-	case log_level::none:
-	case log_level::trace:
-		break;
-	case log_level::info:
-		color_code = "\x1b[32m";
-		break;
-	case log_level::debug:
-		color_code = "\x1b[34m";
-		break;
-	case log_level::warning:
-		color_code = "\x1b[33m";
-		break;
-	case log_level::error:
-		color_code = "\x1b[31m";
-		break;
-	case log_level::critical:
-		color_code = "\x1b[91m";
-		break;
-	default:
-		break;
+		const size_t large_page_size = GetLargePageMinimum();
+		if (large_page_size != 0)
+		{
+			const size_t large_length = (bytes + large_page_size - 1) / large_page_size * large_page_size;
+			ptr = VirtualAlloc(nullptr, large_length, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			large = ptr != nullptr;
+			if (large)
+				length = large_length;
+		}
+	}
+	if (!ptr)
+	{
+		ptr = VirtualAlloc(nullptr, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		if (!ptr)
+			throw std::bad_alloc();
+		fell_back = huge;
 	}
 
-	fwrite(color_code, sizeof(char), strlen(color_code), stdout);
+	for (size_t offset = 0; offset < length; offset += page_size)
+		static_cast<volatile char*>(ptr)[offset] = 0;
+	if (m_lock_pages && !large && !VirtualLock(ptr, length)) // Large pages are never paged out.
+		fell_back = true;
+	if (fell_back)
+		m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+	return ptr;
 }
 
-void dtlog::logger::set_stderr_color(log_level level)
+void dtlog::page_resource::do_deallocate(void* ptr, size_t bytes, size_t alignment)
 {
-	const char* color_code = "\x1b[0m";
+	(void)bytes;
+	(void)alignment;
+	VirtualFree(ptr, 0, MEM_RELEASE);
+}
 
-	switch (level)
+#else // _WIN32
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+void* dtlog::page_resource::do_allocate(size_t bytes, size_t alignment)
+{
+	const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	if (alignment > page_size)
+		throw std::bad_alloc();
+	if (bytes == 0)
+		bytes = 1;
+
+	const bool huge = m_huge_pages && bytes >= huge_page_size;
+	const size_t granularity = huge ? huge_page_size : page_size;
+	const size_t length = (bytes + granularity - 1) / granularity * granularity;
+	bool fell_back = false;
+	void* ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	if (huge)
+		ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif // MAP_HUGETLB
+	if (ptr == MAP_FAILED)
 	{
-	case log_level::none:
-	case log_level::trace:
-		break;
-	case log_level::info:
-		color_code = "\x1b[32m";
-		break;
-	case log_level::debug:
-		color_code = "\x1b[34m";
-		break;
-	case log_level::warning:
-		color_code = "\x1b[33m";
-		break;
-	case log_level::error:
-		color_code = "\x1b[31m";
-		break;
-	case log_level::critical:
-		color_code = "\x1b[91m";
-		break;
-	default:
-		break;
+		ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ptr == MAP_FAILED)
+			throw std::bad_alloc();
+		if (huge)
+		{
+			fell_back = true;
+#ifdef MADV_HUGEPAGE
+			madvise(ptr, length, MADV_HUGEPAGE);
+#endif // MADV_HUGEPAGE
+		}
 	}
 
-	fwrite(color_code, sizeof(char), strlen(color_code), stderr);
+	for (size_t offset = 0; offset < length; offset += page_size)
+		static_cast<volatile char*>(ptr)[offset] = 0;
+	if (m_lock_pages && mlock(ptr, length) != 0)
+		fell_back = true;
+	if (fell_back)
+		m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+	return ptr;
+}
+
+void dtlog::page_resource::do_deallocate(void* ptr, size_t bytes, size_t alignment)
+{
+	(void)alignment;
+	const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	if (bytes == 0)
+		bytes = 1;
+	const size_t granularity = (m_huge_pages && bytes >= huge_page_size) ? huge_page_size : page_size;
+	munmap(ptr, (bytes + granularity - 1) / granularity * granularity);
+}
+
+#endif // _WIN32
+
+#ifdef _WIN32
+
+std::uint64_t dtlog::trace_sink::current_process_id()
+{
+	return static_cast<std::uint64_t>(GetCurrentProcessId());
+}
+
+std::uint64_t dtlog::trace_sink::current_thread_id()
+{
+	return static_cast<std::uint64_t>(GetCurrentThreadId());
+}
+
+#else // _WIN32
+
+#include <pthread.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif // __linux__
+
+std::uint64_t dtlog::trace_sink::current_process_id()
+{
+	return static_cast<std::uint64_t>(getpid());
+}
+
+std::uint64_t dtlog::trace_sink::current_thread_id()
+{
+	static thread_local const std::uint64_t id = []
+	{
+#if defined(__linux__)
+		return static_cast<std::uint64_t>(syscall(SYS_gettid));
+#elif defined(__APPLE__)
+		std::uint64_t thread_id = 0;
+		pthread_threadid_np(nullptr, &thread_id);
+		return thread_id;
+#else // __linux__
+		return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(pthread_self()));
+#endif // __linux__
+	}();
+	return id;
 }
 
 #endif // _WIN32
\ No newline at end of file
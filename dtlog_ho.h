@@ -19,9 +19,28 @@
 #define _CRT_SECURE_NO_WARNINGS
 #endif // _CRT_SECURE_NO_WARNINGS
 
-#include <string>    // @brief Include for std::string.
-#include <sstream>   // @brief Include for std::ostringstream.
-#include <iomanip>   // @brief Include for std::setw and std::setfill.
+#include <string>      // @brief Include for std::string.
+#include <string_view> // @brief Include for std::string_view.
+#include <sstream>     // @brief Include for std::ostringstream.
+#include <iomanip>     // @brief Include for std::setw and std::setfill.
+#include <cstring>     // @brief Include for std::memcpy and std::strlen.
+#include <cstdint>     // @brief Include for std::uintptr_t.
+#include <cstdlib>     // @brief Include for std::malloc, std::realloc and std::free.
+#include <cstddef>     // @brief Include for std::max_align_t.
+#include <new>         // @brief Include for placement new and std::bad_alloc.
+#include <stdexcept>   // @brief Include for std::out_of_range and std::invalid_argument.
+#include <cstdio>      // @brief Include for std::snprintf and std::fwrite.
+#include <ctime>       // @brief Include for std::time, clock_gettime, localtime_r / localtime_s and std::tm.
+#include <atomic>      // @brief Include for std::atomic.
+#include <chrono>      // @brief Include for std::chrono::steady_clock.
+#include <iterator>    // @brief Include for std::begin, std::end, std::data and std::size.
+#include <type_traits> // @brief Include for the type traits used by the formatter.
+#include <utility>     // @brief Include for std::pair, std::forward and std::declval.
+#include <tuple>       // @brief Include for std::tuple.
+#include <mutex>       // @brief Include for std::mutex.
+#if __has_include(<charconv>)
+#include <charconv>    // @brief Include for std::to_chars.
+#endif // __has_include(<charconv>)
 
 #ifdef _WIN32
 
@@ -29,6 +48,13 @@
 #define WIN32_LEAN_AND_MEAN
 #endif // WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#else // _WIN32
+#include <sys/mman.h> // @brief Include for mmap, madvise and mlock.
+#include <unistd.h>   // @brief Include for sysconf and getpid.
+#include <pthread.h>  // @brief Include for pthread_self.
+#if defined(__linux__)
+#include <sys/syscall.h> // @brief Include for SYS_gettid.
+#endif // __linux__
 #endif // _WIN32
 
 #if _HAS_NODISCARD
@@ -37,681 +63,4761 @@
 #define DTLOG_NODISCARD  // @brief Otherwise, it expands to nothing.
 #endif // _HAS_NODISCARD
 
+#if defined(__cpp_consteval) && __cpp_consteval >= 201811L
+#define DTLOG_HAS_CONSTEVAL 1     // @brief printf format string literals are checked at compile time.
+#define DTLOG_CONSTEVAL consteval // @brief printf format strings are checked at compile time.
+#else // !__cpp_consteval
+#define DTLOG_HAS_CONSTEVAL 0     // @brief printf format string literals are checked when they are first used; wrap them in DTLOG_PRINTF for a compile-time check.
+#define DTLOG_CONSTEVAL           // @brief printf format strings are checked when they are used.
+#endif // __cpp_consteval
+
+#ifndef DTLOG_USE_STD_FORMAT
+#define DTLOG_USE_STD_FORMAT 0 // @brief Define as 1 to write the arguments std::format supports with std::format.
+#endif // DTLOG_USE_STD_FORMAT
+
+#if DTLOG_USE_STD_FORMAT
+#if __has_include(<format>)
+#include <format>      // @brief Include for std::vformat_to and std::format_error.
+#endif // __has_include(<format>)
+#ifndef __cpp_lib_format
+#error "DTLOG_USE_STD_FORMAT requires a standard library with std::format."
+#endif // __cpp_lib_format
+#endif // DTLOG_USE_STD_FORMAT
+
+#ifndef DTLOG_ALLOCATION_FREE
+#define DTLOG_ALLOCATION_FREE 0 // @brief Define as 1 to reject argument types whose formatting always allocates.
+#endif // DTLOG_ALLOCATION_FREE
+
+#ifndef DTLOG_INSTRUMENT_STAGES
+#define DTLOG_INSTRUMENT_STAGES 0 // @brief Define as 1 to time the stages of every record into the histograms read by get_stage_stats().
+#endif // DTLOG_INSTRUMENT_STAGES
+
+#if __has_include(<memory_resource>)
+#define DTLOG_HAS_PMR 1        // @brief std::pmr::memory_resource is available.
+#include <memory_resource>     // @brief Include for std::pmr::memory_resource.
+#endif // __has_include(<memory_resource>)
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DTLOG_HAS_SSE2 1 // @brief SSE2 kernels are used where available.
+#include <emmintrin.h>   // @brief Include for the SSE2 intrinsics.
+#endif // __SSE2__
+
+#if defined(__AVX2__)
+#define DTLOG_HAS_AVX2 1 // @brief AVX2 kernels are used where available.
+#include <immintrin.h>   // @brief Include for the AVX2 intrinsics.
+#endif // __AVX2__
+
+#if defined(_MSC_VER)
+#include <intrin.h>      // @brief Include for _BitScanForward and __rdtsc.
+#elif DTLOG_INSTRUMENT_STAGES && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>   // @brief Include for __rdtsc.
+#endif // _MSC_VER
+
 namespace dtlog
 {
+#if DTLOG_HAS_PMR
     /**
-     * @brief A helper template class for managing a dynamic array of elements.
-     *
-     * This class provides basic functionalities like adding, accessing, and managing
-     * elements in a dynamic array. It includes methods for size, capacity, and
-     * iterators for the beginning and end of the array.
+     * @brief The memory resource interface used for every allocation made by dtlog.
      */
-    template <typename T>
-    class helper_vector
+    using memory_resource = std::pmr::memory_resource;
+#else // !DTLOG_HAS_PMR
+    /**
+     * @brief A minimal stand-in for std::pmr::memory_resource on standard libraries that lack <memory_resource>.
+     */
+    class memory_resource
     {
     public:
-        /**
-         * @brief Constructor initializes the vector with null data, zero capacity, and size.
-         */
-        helper_vector() : m_data(nullptr), m_capacity(0), m_size(0) {}
+        virtual ~memory_resource() {}
 
-        /**
-         * @brief Destructor cleans up the dynamically allocated data.
-         */
-        ~helper_vector()
+        void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
         {
-            delete[] m_data;
+            return do_allocate(bytes, alignment);
         }
 
-        /**
-         * @brief Overloaded subscript operator for accessing elements by index with bounds checking.
-         * @param index The index of the element to access.
-         * @return Reference to the element at the specified index.
-         * @throws std::out_of_range if index is out of bounds.
-         */
-        T& operator[](size_t index)
+        void deallocate(void* ptr, size_t bytes, size_t alignment = alignof(std::max_align_t))
         {
-            if (index >= m_size)
-                throw std::out_of_range("Index out of range!");
-            return m_data[index];
+            do_deallocate(ptr, bytes, alignment);
+        }
+
+        bool is_equal(const memory_resource& other) const noexcept
+        {
+            return do_is_equal(other);
         }
 
+    private:
+        virtual void* do_allocate(size_t bytes, size_t alignment) = 0;
+        virtual void do_deallocate(void* ptr, size_t bytes, size_t alignment) = 0;
+        virtual bool do_is_equal(const memory_resource& other) const noexcept = 0;
+    };
+#endif // DTLOG_HAS_PMR
+
+    /**
+     * @brief Holds the process-wide default memory resource of dtlog.
+     */
+    struct default_resource_holder
+    {
+        inline static std::atomic<memory_resource*> resource{ nullptr }; ///< The default resource; nullptr selects malloc/realloc.
+    };
+
+    /**
+     * @brief Sets the memory resource used by dtlog containers and buffers created without an explicit resource.
+     *
+     * Objects keep the resource they were created with, so the resource must outlive them.
+     * @param resource The new default resource. nullptr (the initial value) selects std::malloc/std::realloc.
+     */
+    inline void set_default_resource(memory_resource* resource)
+    {
+        default_resource_holder::resource.store(resource, std::memory_order_release);
+    }
+
+    /**
+     * @brief Gets the memory resource used by dtlog containers and buffers created without an explicit resource.
+     * @return The default resource, or nullptr for std::malloc/std::realloc.
+     */
+    DTLOG_NODISCARD inline memory_resource* get_default_resource()
+    {
+        return default_resource_holder::resource.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Holds the memory resource of the per-thread record buffers.
+     */
+    struct record_buffer_resource_holder
+    {
+        inline static std::atomic<memory_resource*> resource{ nullptr }; ///< The resource; nullptr selects malloc/realloc.
+    };
+
+    /**
+     * @brief Sets the memory resource of the per-thread record buffers that every logger builds its records in.
+     *
+     * A thread takes the resource current when it first logs and keeps it, so set it before the logging threads start.
+     * The resource must outlive those threads. Other dtlog buffers keep using the default resource.
+     * @param resource The new resource. nullptr (the initial value) selects std::malloc/std::realloc.
+     */
+    inline void set_record_buffer_resource(memory_resource* resource)
+    {
+        record_buffer_resource_holder::resource.store(resource, std::memory_order_release);
+    }
+
+    /**
+     * @brief Gets the memory resource of the per-thread record buffers.
+     * @return The resource, or nullptr for std::malloc/std::realloc.
+     */
+    DTLOG_NODISCARD inline memory_resource* get_record_buffer_resource()
+    {
+        return record_buffer_resource_holder::resource.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Selects what the per-thread record buffers of the logger do when a record does not fit.
+     */
+    enum class allocation_policy
+    {
+        grow,    ///< The buffers grow (the default). Use this during warm-up.
+        truncate ///< The buffers keep their capacity and the record is truncated, so logging never allocates.
+    };
+
+    /**
+     * @brief Holds the process-wide allocation policy of dtlog.
+     */
+    struct allocation_policy_holder
+    {
+        inline static std::atomic<allocation_policy> policy{ allocation_policy::grow }; ///< The current policy.
+    };
+
+    /**
+     * @brief Sets the allocation policy of the logger's per-thread record buffers.
+     *
+     * Log with allocation_policy::grow until the buffers have reached the size of the longest records (the warm-up),
+     * then switch to allocation_policy::truncate to guarantee that the logging hot path does not allocate.
+     * @param policy The new policy.
+     */
+    inline void set_allocation_policy(allocation_policy policy)
+    {
+        allocation_policy_holder::policy.store(policy, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Gets the allocation policy of the logger's per-thread record buffers.
+     * @return The current policy.
+     */
+    DTLOG_NODISCARD inline allocation_policy get_allocation_policy()
+    {
+        return allocation_policy_holder::policy.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief The stages of writing a record, timed when DTLOG_INSTRUMENT_STAGES is 1.
+     */
+    enum class stage
+    {
+        capture, ///< Capturing the arguments of formatter::format_to.
+        format,  ///< Rendering the format string with the captured arguments.
+        pattern, ///< Applying the pattern of the logger, including reading the time.
+        color,   ///< Switching the color of stdout or stderr.
+        write,   ///< The std::fwrite call.
+        flush    ///< The std::fflush call.
+    };
+
+    /**
+     * @brief The number of stages.
+     */
+    constexpr size_t stage_count = 6;
+
+    /**
+     * @brief The number of buckets of a stage histogram: bucket i counts durations in [2^i, 2^(i+1)) ticks.
+     */
+    constexpr size_t stage_bucket_count = 64;
+
+    /**
+     * @brief Gets the name of a stage.
+     * @param value The stage.
+     * @return The name, pointing into a static table.
+     */
+    DTLOG_NODISCARD constexpr std::string_view stage_name(stage value)
+    {
+        constexpr std::string_view names[stage_count] = { "capture", "format", "pattern", "color", "write", "flush" };
+        return static_cast<size_t>(value) < stage_count ? names[static_cast<size_t>(value)] : std::string_view();
+    }
+
+    /**
+     * @brief A snapshot of the durations measured for one stage, in ticks: time stamp counter cycles on x86,
+     * nanoseconds elsewhere.
+     */
+    struct stage_stats
+    {
+        std::uint64_t count = 0;                             ///< The number of measurements.
+        std::uint64_t total_ticks = 0;                       ///< The sum of the durations.
+        std::uint64_t max_ticks = 0;                         ///< The longest duration.
+        std::uint64_t buckets[stage_bucket_count] = {};      ///< The log2 histogram of the durations.
+
         /**
-         * @brief Const version of the overloaded subscript operator for accessing elements by index with bounds checking.
-         * @param index The index of the element to access.
-         * @return Const reference to the element at the specified index.
-         * @throws std::out_of_range if index is out of bounds.
+         * @brief Gets the mean duration.
+         * @return The mean in ticks, or 0 without measurements.
          */
-        const T& operator[](size_t index) const
+        DTLOG_NODISCARD double mean_ticks() const
         {
-            if (index >= m_size)
-                throw std::out_of_range("Index out of range!");
-            return m_data[index];
+            return count ? static_cast<double>(total_ticks) / static_cast<double>(count) : 0.0;
         }
 
         /**
-         * @brief Adds a new element to the end of the vector.
-         * @param value The value to add.
+         * @brief Gets an upper bound of a percentile from the histogram.
+         * @param fraction The fraction of the measurements, between 0 and 1.
+         * @return The upper end of the bucket holding the percentile, at most max_ticks.
          */
-        void push_back(const T& value)
+        DTLOG_NODISCARD std::uint64_t percentile(double fraction) const
         {
-            if (m_size >= m_capacity)
+            if (count == 0)
+                return 0;
+            std::uint64_t rank = static_cast<std::uint64_t>(fraction * static_cast<double>(count) + 0.5);
+            rank = rank ? rank : 1;
+            std::uint64_t seen = 0;
+            for (size_t i = 0; i < stage_bucket_count; ++i)
             {
-                size_t new_capacity = (m_capacity == 0) ? 1 : m_capacity * 2;
-                reserve(new_capacity);
+                seen += buckets[i];
+                if (seen >= rank)
+                {
+                    const std::uint64_t upper = i + 1 < stage_bucket_count ? (std::uint64_t(2) << i) - 1 : ~std::uint64_t(0);
+                    return upper < max_ticks ? upper : max_ticks;
+                }
             }
-            m_data[m_size++] = value;
+            return max_ticks;
         }
+    };
 
+    namespace detail
+    {
         /**
-         * @brief Removes the last element of the vector.
+         * @brief The process-wide histogram of one stage, updated with relaxed atomic operations.
          */
-        void pop_back()
+        struct stage_histogram
         {
-            if (m_size > 0)
-                --m_size;
-        }
+            std::atomic<std::uint64_t> count{ 0 };                     ///< The number of measurements.
+            std::atomic<std::uint64_t> total_ticks{ 0 };               ///< The sum of the durations.
+            std::atomic<std::uint64_t> max_ticks{ 0 };                 ///< The longest duration.
+            std::atomic<std::uint64_t> buckets[stage_bucket_count] = {}; ///< The log2 histogram of the durations.
+        };
 
         /**
-         * @brief Gets the current size of the vector.
-         * @return The number of elements in the vector.
+         * @brief Gets the histograms of every stage.
+         * @return The histograms, indexed by stage.
          */
-        size_t size() const
+        inline stage_histogram* stage_histograms()
         {
-            return m_size;
+            static stage_histogram histograms[stage_count];
+            return histograms;
         }
 
         /**
-         * @brief Gets the current capacity of the vector.
-         * @return The capacity of the vector.
+         * @brief Reads the tick counter the stages are timed with.
+         * @return The time stamp counter on x86, steady_clock nanoseconds elsewhere.
          */
-        size_t capacity() const
+        inline std::uint64_t stage_ticks()
         {
-            return m_capacity;
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+            return __rdtsc();
+#elif DTLOG_INSTRUMENT_STAGES && (defined(__x86_64__) || defined(__i386__))
+            return __rdtsc();
+#else // x86
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif // x86
         }
 
         /**
-         * @brief Returns a pointer to the beginning of the vector.
-         * @return Pointer to the first element of the vector.
+         * @brief Adds the time since start to the histogram of a stage.
+         * @param value The stage.
+         * @param start The tick the stage started at.
          */
-        T* begin() const
+        inline void record_stage(stage value, std::uint64_t start)
         {
-            return m_data;
+            const std::uint64_t ticks = stage_ticks() - start;
+            size_t bucket = 0;
+            for (std::uint64_t rest = ticks >> 1; rest; rest >>= 1)
+                ++bucket;
+
+            stage_histogram& histogram = stage_histograms()[static_cast<size_t>(value)];
+            histogram.count.fetch_add(1, std::memory_order_relaxed);
+            histogram.total_ticks.fetch_add(ticks, std::memory_order_relaxed);
+            histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+            std::uint64_t current = histogram.max_ticks.load(std::memory_order_relaxed);
+            while (current < ticks && !histogram.max_ticks.compare_exchange_weak(current, ticks, std::memory_order_relaxed))
+                ;
         }
 
         /**
-         * @brief Returns a pointer to the end of the vector.
-         * @return Pointer to one past the last element of the vector.
+         * @brief Times the rest of the enclosing scope as one stage.
          */
-        T* end() const
+        class stage_scope
         {
-            return m_data + m_size;
-        }
+        public:
+            /**
+             * @brief Starts timing.
+             * @param value The stage.
+             */
+            explicit stage_scope(stage value) : m_stage(value), m_start(stage_ticks()) {}
 
-    private:
-        /**
-         * @brief Reserves memory for the vector.
-         * @param new_capacity The new capacity for the vector.
-         */
-        void reserve(size_t new_capacity)
+            stage_scope(const stage_scope&) = delete;
+            stage_scope& operator=(const stage_scope&) = delete;
+
+            /**
+             * @brief Records the duration.
+             */
+            ~stage_scope()
+            {
+                record_stage(m_stage, m_start);
+            }
+
+        private:
+            stage m_stage;         ///< The timed stage.
+            std::uint64_t m_start; ///< The tick timing started at.
+        };
+    } // namespace detail
+
+    /**
+     * @brief Reads the histogram of a stage. Without DTLOG_INSTRUMENT_STAGES every histogram stays empty.
+     * @param value The stage.
+     * @return The snapshot.
+     */
+    DTLOG_NODISCARD inline stage_stats get_stage_stats(stage value)
+    {
+        stage_stats out;
+        if (static_cast<size_t>(value) >= stage_count)
+            return out;
+        const detail::stage_histogram& histogram = detail::stage_histograms()[static_cast<size_t>(value)];
+        out.count = histogram.count.load(std::memory_order_relaxed);
+        out.total_ticks = histogram.total_ticks.load(std::memory_order_relaxed);
+        out.max_ticks = histogram.max_ticks.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < stage_bucket_count; ++i)
+            out.buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+        return out;
+    }
+
+    /**
+     * @brief Empties the histograms of every stage.
+     */
+    inline void reset_stage_stats()
+    {
+        for (size_t i = 0; i < stage_count; ++i)
         {
-            T* new_data = new T[new_capacity];
-            std::memcpy(new_data, m_data, sizeof(T) * m_size);
-            delete[] m_data;
-            m_data = new_data;
-            m_capacity = new_capacity;
+            detail::stage_histogram& histogram = detail::stage_histograms()[i];
+            histogram.count.store(0, std::memory_order_relaxed);
+            histogram.total_ticks.store(0, std::memory_order_relaxed);
+            histogram.max_ticks.store(0, std::memory_order_relaxed);
+            for (std::atomic<std::uint64_t>& bucket : histogram.buckets)
+                bucket.store(0, std::memory_order_relaxed);
         }
-    private:
-        T* m_data;         ///< Pointer to the dynamically allocated array.
-        size_t m_capacity; ///< The current capacity of the vector.
-        size_t m_size;     ///< The current size of the vector.
-    };
+    }
+
+#if DTLOG_INSTRUMENT_STAGES
+#define DTLOG_STAGE_SCOPE(stage_value) ::dtlog::detail::stage_scope dtlog_stage_scope(::dtlog::stage::stage_value) // @brief Times the rest of the scope as a stage.
+#define DTLOG_STAGE_START(start) const std::uint64_t start = ::dtlog::detail::stage_ticks()                      // @brief Reads the tick a stage starts at.
+#define DTLOG_STAGE_STOP(stage_value, start) ::dtlog::detail::record_stage(::dtlog::stage::stage_value, start)    // @brief Records a stage started with DTLOG_STAGE_START.
+#else // DTLOG_INSTRUMENT_STAGES
+#define DTLOG_STAGE_SCOPE(stage_value) ((void)0)          // @brief Stage instrumentation is compiled out.
+#define DTLOG_STAGE_START(start) ((void)0)                // @brief Stage instrumentation is compiled out.
+#define DTLOG_STAGE_STOP(stage_value, start) ((void)0)    // @brief Stage instrumentation is compiled out.
+#endif // DTLOG_INSTRUMENT_STAGES
 
     /**
-     * @brief A utility class for formatting strings.
+     * @brief A memory resource that maps whole pages from the operating system, optionally as huge pages and locked
+     * into memory, so buffers built on it take no TLB misses or page faults while logging.
+     *
+     * Blocks of at least huge_page_size bytes are mapped as explicit huge pages (MAP_HUGETLB, MEM_LARGE_PAGES) when
+     * requested; if none are available the mapping falls back to normal pages, advised as transparent huge pages on
+     * Linux. Smaller blocks use normal pages. Every block is pre-faulted and, if requested, locked with mlock or
+     * VirtualLock; a failed lock is not an error. fallback_count() reports how often a request could not be met.
+     * Every block costs at least a page and a system call, so install it for the per-thread record buffers with
+     * set_record_buffer_resource() before the logging threads start rather than as the default resource.
      */
-    class formatter
+    class page_resource : public memory_resource
     {
     public:
+        static constexpr size_t huge_page_size = 2 * 1024 * 1024; ///< The size blocks are rounded to for huge pages.
+
         /**
-         * @brief Formats a string with the given arguments.
-         * @tparam _Args The types of the arguments.
-         * @param fmt The format string.
-         * @param args The arguments to format into the string.
-         * @return The formatted string.
+         * @brief Constructs the resource.
+         * @param huge_pages True to map large blocks as huge pages.
+         * @param lock_pages True to lock the pages into memory.
          */
-        template <typename... _Args>
-        DTLOG_NODISCARD static std::string format(const std::string& fmt, _Args&&... args)
+        explicit page_resource(bool huge_pages = true, bool lock_pages = true)
+            : m_huge_pages(huge_pages), m_lock_pages(lock_pages), m_fallbacks(0) {}
+
+        page_resource(const page_resource&) = delete;
+        page_resource& operator=(const page_resource&) = delete;
+
+        /**
+         * @brief Checks whether large blocks are mapped as huge pages.
+         * @return True if huge pages are requested.
+         */
+        DTLOG_NODISCARD bool huge_pages() const
         {
-            if (sizeof...(args) == 0)
-            {
-                return fmt;
-            }
+            return m_huge_pages;
+        }
 
-            argument_array argArray;
-            transfer_to_array(argArray, std::forward<_Args>(args)...);
-            size_t start = 0;
-            size_t pos = 0;
-            std::ostringstream oss;
-            while (true)
-            {
-                pos = fmt.find('{', start);
-                if (pos == std::string::npos)
-                {
-                    oss << fmt.substr(start);
-                    break;
-                }
+        /**
+         * @brief Checks whether the pages are locked into memory.
+         * @return True if locking is requested.
+         */
+        DTLOG_NODISCARD bool lock_pages() const
+        {
+            return m_lock_pages;
+        }
 
-                oss << fmt.substr(start, pos - start);
-                if (fmt[pos + 1] == '{')
-                {
-                    oss << '{';
-                    start = pos + 2;
-                    continue;
-                }
+        /**
+         * @brief Gets the number of blocks that did not get huge pages or could not be locked as requested.
+         * @return The number of fallbacks so far.
+         */
+        DTLOG_NODISCARD size_t fallback_count() const
+        {
+            return m_fallbacks.load(std::memory_order_relaxed);
+        }
 
-                start = pos + 1;
-                pos = fmt.find('}', start);
-                if (pos == std::string::npos)
+    private:
+#ifdef _WIN32
+        /**
+         * @brief Maps a block of pages.
+         * @param bytes The size of the block.
+         * @param alignment The alignment of the block (at most the page size).
+         * @return The block.
+         * @throw std::bad_alloc If the block cannot be mapped.
+         */
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            SYSTEM_INFO system_info;
+            GetSystemInfo(&system_info);
+            const size_t page_size = system_info.dwPageSize;
+            if (alignment > page_size)
+                throw std::bad_alloc();
+            if (bytes == 0)
+                bytes = 1;
+
+            const bool huge = m_huge_pages && bytes >= huge_page_size;
+            bool fell_back = false;
+            bool large = false;
+            void* ptr = nullptr;
+            size_t length = (bytes + page_size - 1) / page_size * page_size;
+            if (huge)
+            {
+                const size_t large_page_size = GetLargePageMinimum();
+                if (large_page_size != 0)
                 {
-                    oss << fmt.substr(start - 1);
-                    break;
+                    const size_t large_length = (bytes + large_page_size - 1) / large_page_size * large_page_size;
+                    ptr = VirtualAlloc(nullptr, large_length, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+                    large = ptr != nullptr;
+                    if (large)
+                        length = large_length;
                 }
-
-                format_item(oss, fmt.substr(start, pos - start), argArray);
-                start = pos + 1;
+            }
+            if (!ptr)
+            {
+                ptr = VirtualAlloc(nullptr, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+                if (!ptr)
+                    throw std::bad_alloc();
+                fell_back = huge;
             }
 
-            return oss.str();
+            for (size_t offset = 0; offset < length; offset += page_size)
+                static_cast<volatile char*>(ptr)[offset] = 0;
+            if (m_lock_pages && !large && !VirtualLock(ptr, length)) // Large pages are never paged out.
+                fell_back = true;
+            if (fell_back)
+                m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+            return ptr;
         }
 
         /**
-         * @brief Overloaded function call operator to format strings.
-         * @tparam Args The types of the arguments.
-         * @param fmt The format string.
-         * @param args The arguments to format into the string.
-         * @return The formatted string.
+         * @brief Unmaps a block of pages.
+         * @param ptr The block.
+         * @param bytes The size the block was allocated with.
+         * @param alignment The alignment the block was allocated with.
          */
-        template <typename... Args>
-        std::string operator()(const std::string& fmt, Args&&... args)
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
         {
-            return format(fmt, std::forward<Args>(args)...);
+            (void)bytes;
+            (void)alignment;
+            VirtualFree(ptr, 0, MEM_RELEASE);
         }
-
-    private:
+#else // _WIN32
         /**
-         * @brief Base class for arguments used in formatting.
+         * @brief Maps a block of pages.
+         * @param bytes The size of the block.
+         * @param alignment The alignment of the block (at most the page size).
+         * @return The block.
+         * @throw std::bad_alloc If the block cannot be mapped.
          */
-        struct argument_base
+        void* do_allocate(size_t bytes, size_t alignment) override
         {
-            argument_base() {}
-            virtual ~argument_base() {}
-            virtual void format(std::ostringstream&) {}
-        };
+            const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            if (alignment > page_size)
+                throw std::bad_alloc();
+            if (bytes == 0)
+                bytes = 1;
+
+            const bool huge = m_huge_pages && bytes >= huge_page_size;
+            const size_t granularity = huge ? huge_page_size : page_size;
+            const size_t length = (bytes + granularity - 1) / granularity * granularity;
+            bool fell_back = false;
+            void* ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+            if (huge)
+                ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif // MAP_HUGETLB
+            if (ptr == MAP_FAILED)
+            {
+                ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (ptr == MAP_FAILED)
+                    throw std::bad_alloc();
+                if (huge)
+                {
+                    fell_back = true;
+#ifdef MADV_HUGEPAGE
+                    madvise(ptr, length, MADV_HUGEPAGE);
+#endif // MADV_HUGEPAGE
+                }
+            }
+
+            for (size_t offset = 0; offset < length; offset += page_size)
+                static_cast<volatile char*>(ptr)[offset] = 0;
+            if (m_lock_pages && mlock(ptr, length) != 0)
+                fell_back = true;
+            if (fell_back)
+                m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+            return ptr;
+        }
 
         /**
-         * @brief Template class for holding arguments of various types.
-         * @tparam _Ty The type of the argument.
+         * @brief Unmaps a block of pages.
+         * @param ptr The block.
+         * @param bytes The size the block was allocated with.
+         * @param alignment The alignment the block was allocated with.
          */
-        template <class _Ty>
-        class argument : public argument_base
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
         {
-        public:
-            /**
-             * @brief Constructs an argument with the given value.
+            (void)alignment;
+            const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            if (bytes == 0)
+                bytes = 1;
+            const size_t granularity = (m_huge_pages && bytes >= huge_page_size) ? huge_page_size : page_size;
+            munmap(ptr, (bytes + granularity - 1) / granularity * granularity);
+        }
+#endif // _WIN32
+
+        bool do_is_equal(const memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        bool m_huge_pages;                 ///< Whether large blocks are mapped as huge pages.
+        bool m_lock_pages;                 ///< Whether the pages are locked into memory.
+        std::atomic<size_t> m_fallbacks;   ///< The number of requests that could not be met.
+    };
+
+    /**
+     * @brief A helper template class for managing a dynamic array of elements.
+     *
+     * This class provides basic functionalities like adding, accessing, and managing
+     * elements in a dynamic array. It includes methods for size, capacity, and
+     * iterators for the beginning and end of the array.
+     *
+     * The first N elements are stored inline, so short arrays never touch the heap.
+     * When the array outgrows its storage, trivially copyable elements are relocated with
+     * std::realloc (or a single std::memcpy out of the inline storage); other elements are
+     * move-constructed into the new block and the old ones destroyed.
+     *
+     * Heap blocks come from the memory resource given at construction (get_default_resource() by default);
+     * without a resource std::malloc/std::realloc/std::free are used.
+     * @tparam T The element type.
+     * @tparam N The number of elements stored inline.
+     */
+    template <typename T, size_t N = 8>
+    class helper_vector
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "dtlog::helper_vector: over-aligned element types are not supported.");
+
+    public:
+        static constexpr size_t inline_capacity = N; ///< The number of elements stored without allocating.
+
+        /**
+         * @brief Constructor initializes an empty vector that uses the inline storage.
+         */
+        helper_vector() : helper_vector(get_default_resource()) {}
+
+        /**
+         * @brief Constructor initializes an empty vector that allocates from the given resource.
+         * @param resource The memory resource for heap blocks, or nullptr for std::malloc.
+         */
+        explicit helper_vector(memory_resource* resource) : m_data(inline_data()), m_capacity(N), m_size(0), m_resource(resource) {}
+
+        /**
+         * @brief Copy constructor copies every element of other. The copy uses the memory resource of other.
+         * @param other The vector to copy.
+         */
+        helper_vector(const helper_vector& other) : helper_vector(other.m_resource)
+        {
+            reserve(other.m_size);
+            for (const T& item : other)
+                emplace_back(item);
+        }
+
+        /**
+         * @brief Move constructor takes the heap block of other, or moves its inline elements.
+         * @param other The vector to move from.
+         */
+        helper_vector(helper_vector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) : helper_vector(other.m_resource)
+        {
+            take(other);
+        }
+
+        /**
+         * @brief Destructor destroys the elements and releases the heap block, if any.
+         */
+        ~helper_vector()
+        {
+            clear();
+            release();
+        }
+
+        /**
+         * @brief Copy assignment replaces the elements with copies of the elements of other.
+         * @param other The vector to copy.
+         * @return Reference to this vector.
+         */
+        helper_vector& operator=(const helper_vector& other)
+        {
+            if (this != &other)
+            {
+                clear();
+                reserve(other.m_size);
+                for (const T& item : other)
+                    emplace_back(item);
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Move assignment replaces the elements with the elements of other.
+         * @param other The vector to move from.
+         * @return Reference to this vector.
+         */
+        helper_vector& operator=(helper_vector&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            if (this != &other)
+            {
+                clear();
+                release();
+                m_data = inline_data();
+                m_capacity = N;
+                take(other);
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Overloaded subscript operator for accessing elements by index with bounds checking.
+         * @param index The index of the element to access.
+         * @return Reference to the element at the specified index.
+         * @throws std::out_of_range if index is out of bounds.
+         */
+        T& operator[](size_t index)
+        {
+            if (index >= m_size)
+                throw std::out_of_range("Index out of range!");
+            return m_data[index];
+        }
+
+        /**
+         * @brief Const version of the overloaded subscript operator for accessing elements by index with bounds checking.
+         * @param index The index of the element to access.
+         * @return Const reference to the element at the specified index.
+         * @throws std::out_of_range if index is out of bounds.
+         */
+        const T& operator[](size_t index) const
+        {
+            if (index >= m_size)
+                throw std::out_of_range("Index out of range!");
+            return m_data[index];
+        }
+
+        /**
+         * @brief Adds a new element to the end of the vector.
+         * @param value The value to add.
+         */
+        void push_back(const T& value)
+        {
+            emplace_back(value);
+        }
+
+        /**
+         * @brief Adds a new element to the end of the vector by moving it.
+         * @param value The value to add.
+         */
+        void push_back(T&& value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        /**
+         * @brief Constructs a new element in place at the end of the vector.
+         * @tparam _Args The types of the constructor arguments.
+         * @param args The constructor arguments.
+         * @return Reference to the new element.
+         */
+        template <class... _Args>
+        T& emplace_back(_Args&&... args)
+        {
+            if (m_size == m_capacity)
+                return emplace_back_grow(std::forward<_Args>(args)...);
+            T* item = ::new (static_cast<void*>(m_data + m_size)) T(std::forward<_Args>(args)...);
+            ++m_size;
+            return *item;
+        }
+
+        /**
+         * @brief Removes the last element of the vector.
+         */
+        void pop_back()
+        {
+            if (m_size > 0)
+            {
+                --m_size;
+                m_data[m_size].~T();
+            }
+        }
+
+        /**
+         * @brief Removes all elements while keeping the storage.
+         */
+        void clear()
+        {
+            if constexpr (!std::is_trivially_destructible_v<T>)
+            {
+                for (size_t i = 0; i < m_size; ++i)
+                    m_data[i].~T();
+            }
+            m_size = 0;
+        }
+
+        /**
+         * @brief Reserves memory for the vector.
+         * @param new_capacity The minimum capacity for the vector.
+         */
+        void reserve(size_t new_capacity)
+        {
+            if (new_capacity > m_capacity)
+                relocate(new_capacity);
+        }
+
+        /**
+         * @brief Gets the current size of the vector.
+         * @return The number of elements in the vector.
+         */
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        /**
+         * @brief Gets the current capacity of the vector.
+         * @return The capacity of the vector.
+         */
+        size_t capacity() const
+        {
+            return m_capacity;
+        }
+
+        /**
+         * @brief Gets the memory resource of the vector.
+         * @return The memory resource, or nullptr for std::malloc.
+         */
+        memory_resource* resource() const
+        {
+            return m_resource;
+        }
+
+        /**
+         * @brief Returns a pointer to the beginning of the vector.
+         * @return Pointer to the first element of the vector.
+         */
+        T* begin()
+        {
+            return m_data;
+        }
+
+        /**
+         * @brief Returns a pointer to the beginning of the vector.
+         * @return Const pointer to the first element of the vector.
+         */
+        const T* begin() const
+        {
+            return m_data;
+        }
+
+        /**
+         * @brief Returns a pointer to the end of the vector.
+         * @return Pointer to one past the last element of the vector.
+         */
+        T* end()
+        {
+            return m_data + m_size;
+        }
+
+        /**
+         * @brief Returns a pointer to the end of the vector.
+         * @return Const pointer to one past the last element of the vector.
+         */
+        const T* end() const
+        {
+            return m_data + m_size;
+        }
+
+    private:
+        static constexpr bool is_trivially_relocatable = std::is_trivially_copyable_v<T>; ///< Whether elements can be moved with memcpy/realloc.
+
+        /**
+         * @brief Gets the inline storage.
+         * @return Pointer to the first inline element slot.
+         */
+        T* inline_data()
+        {
+            return reinterpret_cast<T*>(m_inline);
+        }
+
+        /**
+         * @brief Checks whether the elements live in the inline storage.
+         * @return True if the inline storage is in use.
+         */
+        bool is_inline() const
+        {
+            return m_data == reinterpret_cast<const T*>(m_inline);
+        }
+
+        /**
+         * @brief Computes the next capacity of a geometric growth.
+         * @param min_capacity The minimum capacity required.
+         * @return The new capacity.
+         */
+        size_t next_capacity(size_t min_capacity) const
+        {
+            size_t new_capacity = m_capacity * 2;
+            if (new_capacity < min_capacity)
+                new_capacity = min_capacity;
+            return new_capacity;
+        }
+
+        /**
+         * @brief Grows the capacity and constructs a new element at the end.
+         *
+         * The arguments may refer to an element of this vector (as in v.push_back(v[0])), so the new
+         * element is constructed before the old block is released.
+         * @tparam _Args The types of the constructor arguments.
+         * @param args The constructor arguments.
+         * @return Reference to the new element.
+         */
+        template <class... _Args>
+        T& emplace_back_grow(_Args&&... args)
+        {
+            const size_t new_capacity = next_capacity(m_size + 1);
+            if constexpr (is_trivially_relocatable)
+            {
+                // A copy on the stack is cheap and keeps the realloc path of relocate().
+                T value(std::forward<_Args>(args)...);
+                relocate(new_capacity);
+                T* item = ::new (static_cast<void*>(m_data + m_size)) T(value);
+                ++m_size;
+                return *item;
+            }
+            else
+            {
+                T* new_data = allocate(new_capacity);
+                T* item = nullptr;
+                try
+                {
+                    item = ::new (static_cast<void*>(new_data + m_size)) T(std::forward<_Args>(args)...);
+                }
+                catch (...)
+                {
+                    deallocate(new_data, new_capacity);
+                    throw;
+                }
+                try
+                {
+                    move_elements(new_data);
+                }
+                catch (...)
+                {
+                    item->~T();
+                    deallocate(new_data, new_capacity);
+                    throw;
+                }
+                release();
+                m_data = new_data;
+                m_capacity = new_capacity;
+                ++m_size;
+                return *item;
+            }
+        }
+
+        /**
+         * @brief Moves the elements into an uninitialized block and destroys the originals.
+         *
+         * If a move constructor throws, the elements moved so far are destroyed and the originals are kept.
+         * @param new_data The block that receives the elements.
+         */
+        void move_elements(T* new_data)
+        {
+            size_t moved = 0;
+            try
+            {
+                for (; moved < m_size; ++moved)
+                    ::new (static_cast<void*>(new_data + moved)) T(std::move_if_noexcept(m_data[moved]));
+            }
+            catch (...)
+            {
+                for (size_t i = 0; i < moved; ++i)
+                    new_data[i].~T();
+                throw;
+            }
+            for (size_t i = 0; i < m_size; ++i)
+                m_data[i].~T();
+        }
+
+        /**
+         * @brief Moves the elements to a heap block of the given capacity.
+         * @param new_capacity The new capacity, larger than the current one.
+         */
+        void relocate(size_t new_capacity)
+        {
+            T* new_data = nullptr;
+            if constexpr (is_trivially_relocatable)
+            {
+                if (!is_inline() && !m_resource)
+                {
+                    new_data = static_cast<T*>(std::realloc(m_data, new_capacity * sizeof(T)));
+                    if (!new_data)
+                        throw std::bad_alloc();
+                    m_data = new_data;
+                    m_capacity = new_capacity;
+                    return;
+                }
+                new_data = allocate(new_capacity);
+                std::memcpy(static_cast<void*>(new_data), static_cast<const void*>(m_data), m_size * sizeof(T));
+            }
+            else
+            {
+                new_data = allocate(new_capacity);
+                try
+                {
+                    move_elements(new_data);
+                }
+                catch (...)
+                {
+                    deallocate(new_data, new_capacity);
+                    throw;
+                }
+            }
+            release();
+            m_data = new_data;
+            m_capacity = new_capacity;
+        }
+
+        /**
+         * @brief Allocates an uninitialized heap block.
+         * @param count The number of elements the block must hold.
+         * @return Pointer to the block.
+         */
+        T* allocate(size_t count)
+        {
+            if (m_resource)
+                return static_cast<T*>(m_resource->allocate(count * sizeof(T), alignof(T)));
+            void* block = std::malloc(count * sizeof(T));
+            if (!block)
+                throw std::bad_alloc();
+            return static_cast<T*>(block);
+        }
+
+        /**
+         * @brief Returns a heap block obtained from allocate().
+         * @param block Pointer to the block.
+         * @param count The number of elements the block was allocated for.
+         */
+        void deallocate(T* block, size_t count)
+        {
+            if (m_resource)
+                m_resource->deallocate(block, count * sizeof(T), alignof(T));
+            else
+                std::free(block);
+        }
+
+        /**
+         * @brief Releases the heap block, if any. The elements must already be destroyed or relocated.
+         */
+        void release()
+        {
+            if (!is_inline())
+                deallocate(m_data, m_capacity);
+        }
+
+        /**
+         * @brief Takes the elements of other, leaving it empty. This vector must be empty and inline.
+         * @param other The vector to take the elements from.
+         */
+        void take(helper_vector& other)
+        {
+            if (other.is_inline() || other.m_resource != m_resource)
+            {
+                for (T& item : other)
+                    emplace_back(std::move(item));
+                other.clear();
+            }
+            else
+            {
+                m_data = other.m_data;
+                m_capacity = other.m_capacity;
+                m_size = other.m_size;
+                other.m_data = other.inline_data();
+                other.m_capacity = N;
+                other.m_size = 0;
+            }
+        }
+
+    private:
+        T* m_data;                                                         ///< Pointer to the active storage.
+        size_t m_capacity;                                                 ///< The current capacity of the vector.
+        size_t m_size;                                                     ///< The current size of the vector.
+        memory_resource* m_resource;                                       ///< The resource for heap blocks, or nullptr for std::malloc.
+        alignas(T) unsigned char m_inline[(N > 0 ? N : 1) * sizeof(T)];    ///< The inline storage.
+    };
+
+    /**
+     * @brief A growable character buffer used as the output target of the formatter.
+     *
+     * Short outputs are kept in an inline array, so formatting a typical log line does not
+     * touch the heap. Longer outputs spill to a heap block that grows geometrically, taken from
+     * the memory resource given at construction (get_default_resource() by default) or from std::realloc.
+     * A fixed buffer (see set_fixed()) never allocates and drops what does not fit instead.
+     */
+    class format_buffer
+    {
+    public:
+        using value_type = char; ///< The character type, for std::back_inserter.
+
+        static constexpr size_t inline_capacity = 256; ///< The number of characters stored without allocating.
+        static constexpr size_t prepare_limit = 128;   ///< The largest count prepare() accepts on a fixed buffer.
+
+        /**
+         * @brief Constructor initializes an empty buffer that uses the inline storage.
+         */
+        format_buffer() : format_buffer(get_default_resource()) {}
+
+        /**
+         * @brief Constructor initializes an empty buffer that allocates from the given resource.
+         * @param resource The memory resource for heap blocks, or nullptr for std::malloc.
+         */
+        explicit format_buffer(memory_resource* resource)
+            : m_data(m_inline), m_size(0), m_capacity(inline_capacity), m_resource(resource), m_fixed(false), m_truncated(false), m_overflow_pending(false) {}
+
+        /**
+         * @brief Destructor releases the heap block, if any.
+         */
+        ~format_buffer()
+        {
+            release();
+        }
+
+        format_buffer(const format_buffer&) = delete;
+        format_buffer& operator=(const format_buffer&) = delete;
+
+        /**
+         * @brief Appends a single character.
+         * @param c The character to append.
+         */
+        void push_back(char c)
+        {
+            if (m_size == m_capacity && !grow(m_size + 1))
+                return;
+            m_data[m_size++] = c;
+        }
+
+        /**
+         * @brief Appends a range of characters.
+         * @param str Pointer to the first character.
+         * @param count The number of characters to append.
+         */
+        void append(const char* str, size_t count)
+        {
+            if (count == 0)
+                return;
+            if (m_size + count > m_capacity && !grow(m_size + count))
+                count = m_capacity - m_size;
+            std::memcpy(m_data + m_size, str, count);
+            m_size += count;
+        }
+
+        /**
+         * @brief Appends the characters of a string view.
+         * @param str The characters to append.
+         */
+        void append(std::string_view str)
+        {
+            append(str.data(), str.size());
+        }
+
+        /**
+         * @brief Makes room for at least count characters at the end of the buffer.
+         * @param count The number of characters that will be written.
+         * @return Pointer to the first writable character. Call commit() with the number of characters actually written.
+         */
+        char* prepare(size_t count)
+        {
+            if (m_size + count > m_capacity && !grow(m_size + count))
+            {
+                // A fixed buffer hands out scratch space; commit() keeps the part that fits.
+                m_overflow_pending = true;
+                return m_overflow;
+            }
+            return m_data + m_size;
+        }
+
+        /**
+         * @brief Marks characters written through prepare() as part of the buffer.
+         * @param count The number of characters written.
+         */
+        void commit(size_t count)
+        {
+            if (m_overflow_pending)
+            {
+                m_overflow_pending = false;
+                const size_t room = m_capacity - m_size;
+                const size_t kept = count < room ? count : room;
+                std::memcpy(m_data + m_size, m_overflow, kept);
+                m_size += kept;
+                return;
+            }
+            m_size += count;
+        }
+
+        /**
+         * @brief Ensures the buffer can hold at least new_capacity characters. Does nothing on a fixed buffer.
+         * @param new_capacity The requested capacity.
+         */
+        void reserve(size_t new_capacity)
+        {
+            if (new_capacity > m_capacity && !m_fixed)
+                grow(new_capacity);
+        }
+
+        /**
+         * @brief Removes all characters while keeping the storage.
+         */
+        void clear()
+        {
+            m_size = 0;
+            m_truncated = false;
+        }
+
+        /**
+         * @brief Sets whether the buffer may allocate.
+         *
+         * A fixed buffer keeps its current capacity: characters that do not fit are dropped and truncated() becomes true.
+         * @param fixed True to stop the buffer from growing.
+         */
+        void set_fixed(bool fixed)
+        {
+            m_fixed = fixed;
+        }
+
+        /**
+         * @brief Checks whether characters were dropped since the last clear() because the buffer is fixed.
+         * @return True if the contents are truncated.
+         */
+        bool truncated() const
+        {
+            return m_truncated;
+        }
+
+        /**
+         * @brief Gets a pointer to the characters of the buffer.
+         * @return Pointer to the first character.
+         */
+        const char* data() const
+        {
+            return m_data;
+        }
+
+        /**
+         * @brief Gets the number of characters in the buffer.
+         * @return The number of characters.
+         */
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        /**
+         * @brief Gets the current capacity of the buffer.
+         * @return The capacity of the buffer.
+         */
+        size_t capacity() const
+        {
+            return m_capacity;
+        }
+
+        /**
+         * @brief Gets the memory resource of the buffer.
+         * @return The memory resource, or nullptr for std::malloc.
+         */
+        memory_resource* resource() const
+        {
+            return m_resource;
+        }
+
+        /**
+         * @brief Gets a view of the characters of the buffer.
+         * @return A string view over the buffer contents.
+         */
+        std::string_view view() const
+        {
+            return std::string_view(m_data, m_size);
+        }
+
+        /**
+         * @brief Copies the characters of the buffer into a string.
+         * @return The buffer contents.
+         */
+        std::string str() const
+        {
+            return std::string(m_data, m_size);
+        }
+
+    private:
+        /**
+         * @brief Moves the contents to a larger heap block.
+         * @param min_capacity The minimum capacity required.
+         * @return False if the buffer is fixed and was not grown.
+         */
+        bool grow(size_t min_capacity)
+        {
+            if (m_fixed)
+            {
+                m_truncated = true;
+                return false;
+            }
+
+            size_t new_capacity = m_capacity * 2;
+            if (new_capacity < min_capacity)
+                new_capacity = min_capacity;
+
+            char* new_data = nullptr;
+            if (!m_resource && m_data != m_inline)
+            {
+                new_data = static_cast<char*>(std::realloc(m_data, new_capacity));
+                if (!new_data)
+                    throw std::bad_alloc();
+            }
+            else
+            {
+                new_data = static_cast<char*>(m_resource ? m_resource->allocate(new_capacity, 1) : std::malloc(new_capacity));
+                if (!new_data)
+                    throw std::bad_alloc();
+                std::memcpy(new_data, m_data, m_size);
+                release();
+            }
+            m_data = new_data;
+            m_capacity = new_capacity;
+            return true;
+        }
+
+        /**
+         * @brief Releases the heap block, if any.
+         */
+        void release()
+        {
+            if (m_data == m_inline)
+                return;
+            if (m_resource)
+                m_resource->deallocate(m_data, m_capacity, 1);
+            else
+                std::free(m_data);
+        }
+
+    private:
+        char* m_data;                    ///< Pointer to the active storage.
+        size_t m_size;                   ///< The number of characters in the buffer.
+        size_t m_capacity;               ///< The capacity of the active storage.
+        memory_resource* m_resource;     ///< The resource for heap blocks, or nullptr for std::malloc.
+        bool m_fixed;                    ///< Whether the buffer may not grow.
+        bool m_truncated;                ///< Whether characters were dropped since the last clear().
+        bool m_overflow_pending;         ///< Whether the last prepare() returned the overflow scratch space.
+        char m_overflow[prepare_limit];  ///< Scratch space for prepare() on a full fixed buffer.
+        char m_inline[inline_capacity];  ///< The inline storage.
+    };
+
+    /**
+     * @brief Implementation details of the formatter. Not part of the public interface.
+     */
+    namespace detail
+    {
+        template <class _Ty, class = void>
+        struct is_range : std::false_type {};
+
+        template <class _Ty>
+        struct is_range<_Ty, std::void_t<decltype(std::begin(std::declval<const _Ty&>())), decltype(std::end(std::declval<const _Ty&>()))>> : std::true_type {};
+
+        template <class _Ty, class = void>
+        struct is_contiguous_range : std::false_type {};
+
+        template <class _Ty>
+        struct is_contiguous_range<_Ty, std::void_t<decltype(std::data(std::declval<const _Ty&>())), decltype(std::size(std::declval<const _Ty&>()))>> : std::true_type {};
+
+        template <class _Ty, class = void>
+        struct is_map : std::false_type {};
+
+        template <class _Ty>
+        struct is_map<_Ty, std::void_t<typename _Ty::key_type, typename _Ty::mapped_type>> : std::true_type {};
+
+        template <class _Ty>
+        struct is_pair : std::false_type {};
+
+        template <class _First, class _Second>
+        struct is_pair<std::pair<_First, _Second>> : std::true_type {};
+
+        template <class _Ty>
+        constexpr bool is_pair_v = is_pair<_Ty>::value;
+
+        template <class _Ty, class = void>
+        struct is_streamable : std::false_type {};
+
+        template <class _Ty>
+        struct is_streamable<_Ty, std::void_t<decltype(std::declval<std::ostream&>() << std::declval<const _Ty&>())>> : std::true_type {};
+
+        /**
+         * @brief True for the character types that are written as characters rather than numbers.
+         */
+        template <class _Ty>
+        constexpr bool is_character_v = std::is_same_v<_Ty, char> || std::is_same_v<_Ty, signed char> || std::is_same_v<_Ty, unsigned char>;
+
+        /**
+         * @brief True for the integer types that are written with the integer kernel.
+         */
+        template <class _Ty>
+        constexpr bool is_integer_v = std::is_integral_v<_Ty> && !std::is_same_v<_Ty, bool> && !is_character_v<_Ty>;
+
+        /**
+         * @brief True for pointers to characters, which are written as C strings.
+         */
+        template <class _Ty>
+        constexpr bool is_c_string_v = std::is_pointer_v<_Ty> && is_character_v<std::remove_cv_t<std::remove_pointer_t<_Ty>>>;
+
+        template <class>
+        constexpr bool always_false_v = false;
+
+        /**
+         * @brief Selects the type an argument is stored as inside the formatter.
+         *
+         * Synchronous capture (_Owning == false) is used when the arguments are formatted before the
+         * logging call returns: C strings stay pointers, other string-like values become std::string_view,
+         * arithmetic values, enums and pointers are copied and everything else is referenced.
+         * Owning capture (_Owning == true) is used when the arguments outlive the call: string-like
+         * values are copied exactly once into a std::string and other values are decayed copies (or moves).
+         * @tparam _Ty The forwarded type of the argument.
+         * @tparam _Owning Whether the captured value must own its data.
+         */
+        template <class _Ty, bool _Owning = false>
+        struct argument_capture
+        {
+        private:
+            using referenced_type = std::remove_cv_t<std::remove_reference_t<_Ty>>;
+            using value_type = std::decay_t<_Ty>;
+            static constexpr bool is_c_string = is_c_string_v<value_type>;
+            static constexpr bool is_string_like = !is_c_string && !std::is_same_v<value_type, std::nullptr_t> && std::is_convertible_v<const value_type&, std::string_view>;
+            static constexpr bool is_scalar = std::is_scalar_v<referenced_type>;
+
+        public:
+            using type = std::conditional_t<is_c_string || is_string_like,
+                std::conditional_t<_Owning, std::string, std::conditional_t<is_c_string, const char*, std::string_view>>,
+                std::conditional_t<_Owning || is_scalar, value_type, const referenced_type&>>;
+        };
+
+        template <class _Ty, bool _Owning = false>
+        using argument_capture_t = typename argument_capture<_Ty, _Owning>::type;
+
+        /**
+         * @brief Converts an argument to its captured form.
+         * @tparam _Owning Whether the captured value must own its data.
+         * @tparam _Ty The forwarded type of the argument.
+         * @param arg The argument.
+         * @return The captured value.
+         */
+        template <bool _Owning, class _Ty>
+        argument_capture_t<_Ty, _Owning> capture_argument(_Ty&& arg)
+        {
+            using capture_type = argument_capture_t<_Ty, _Owning>;
+            if constexpr (is_c_string_v<std::decay_t<_Ty>>)
+            {
+                const char* str = reinterpret_cast<const char*>(static_cast<const std::remove_pointer_t<std::decay_t<_Ty>>*>(arg));
+                if constexpr (_Owning)
+                    return str ? capture_type(str) : capture_type("(null)");
+                else
+                    return str;
+            }
+            else
+            {
+                return static_cast<capture_type>(std::forward<_Ty>(arg));
+            }
+        }
+
+        /**
+         * @brief Writes the decimal digits of an unsigned value backwards, two digits per step.
+         * @param end Pointer one past the last character to write.
+         * @param value The value to write.
+         * @return Pointer to the first written character.
+         */
+        inline char* write_unsigned_backwards(char* end, unsigned long long value)
+        {
+            static constexpr char digit_pairs[] =
+                "00010203040506070809"
+                "10111213141516171819"
+                "20212223242526272829"
+                "30313233343536373839"
+                "40414243444546474849"
+                "50515253545556575859"
+                "60616263646566676869"
+                "70717273747576777879"
+                "80818283848586878889"
+                "90919293949596979899";
+
+            while (value >= 100)
+            {
+                const size_t index = static_cast<size_t>(value % 100) * 2;
+                value /= 100;
+                end -= 2;
+                std::memcpy(end, digit_pairs + index, 2);
+            }
+
+            if (value < 10)
+            {
+                *--end = static_cast<char>('0' + value);
+            }
+            else
+            {
+                end -= 2;
+                std::memcpy(end, digit_pairs + static_cast<size_t>(value) * 2, 2);
+            }
+            return end;
+        }
+
+        /**
+         * @brief Writes an integer in decimal form straight into the buffer.
+         * @tparam _Ty The integer type.
+         * @param out The output buffer.
+         * @param value The value to write.
+         */
+        template <class _Ty>
+        void write_integer(format_buffer& out, _Ty value)
+        {
+            using unsigned_type = std::make_unsigned_t<_Ty>;
+            unsigned_type magnitude = static_cast<unsigned_type>(value);
+            bool negative = false;
+            if constexpr (std::is_signed_v<_Ty>)
+            {
+                if (value < 0)
+                {
+                    negative = true;
+                    magnitude = static_cast<unsigned_type>(unsigned_type(0) - magnitude);
+                }
+            }
+
+            char digits[24];
+            char* end = digits + sizeof(digits);
+            char* begin = write_unsigned_backwards(end, magnitude);
+            if (negative)
+                *--begin = '-';
+            out.append(begin, static_cast<size_t>(end - begin));
+        }
+
+        /**
+         * @brief Writes a floating point value the way std::ostream does by default (%g, precision 6).
+         * @tparam _Ty The floating point type.
+         * @param out The output buffer.
+         * @param value The value to write.
+         */
+        template <class _Ty>
+        void write_floating(format_buffer& out, _Ty value)
+        {
+            char* first = out.prepare(32);
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+            const std::to_chars_result result = std::to_chars(first, first + 32, value, std::chars_format::general, 6);
+            out.commit(static_cast<size_t>(result.ptr - first));
+#else // !__cpp_lib_to_chars
+            int written = 0;
+            if constexpr (std::is_same_v<_Ty, long double>)
+                written = std::snprintf(first, 32, "%Lg", value);
+            else
+                written = std::snprintf(first, 32, "%g", static_cast<double>(value));
+            if (written > 0)
+                out.commit(static_cast<size_t>(written));
+#endif // __cpp_lib_to_chars
+        }
+
+        /**
+         * @brief Gets the index of the lowest set bit.
+         * @param mask A non-zero bit mask.
+         * @return The index of the lowest set bit.
+         */
+        inline unsigned count_trailing_zeros(unsigned mask)
+        {
+#if defined(_MSC_VER)
+            unsigned long index = 0;
+            _BitScanForward(&index, mask);
+            return static_cast<unsigned>(index);
+#else // !_MSC_VER
+            return static_cast<unsigned>(__builtin_ctz(mask));
+#endif // _MSC_VER
+        }
+
+        /**
+         * @brief Collects the positions of every '{' and '}' of a string in a single pass.
+         *
+         * The string is compared 32 (AVX2) or 16 (SSE2) characters at a time and the matches
+         * are read from the resulting bit mask; the tail is scanned one character at a time.
+         * @param str Pointer to the first character.
+         * @param length The number of characters.
+         * @param positions Receives the positions, in increasing order.
+         */
+        inline void find_braces(const char* str, size_t length, helper_vector<size_t, 32>& positions)
+        {
+            size_t i = 0;
+#if DTLOG_HAS_AVX2
+            const __m256i open_brace_256 = _mm256_set1_epi8('{');
+            const __m256i close_brace_256 = _mm256_set1_epi8('}');
+            for (; i + 32 <= length; i += 32)
+            {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, open_brace_256), _mm256_cmpeq_epi8(block, close_brace_256))));
+                while (mask != 0)
+                {
+                    positions.push_back(i + count_trailing_zeros(mask));
+                    mask &= mask - 1;
+                }
+            }
+#endif // DTLOG_HAS_AVX2
+#if DTLOG_HAS_SSE2
+            const __m128i open_brace = _mm_set1_epi8('{');
+            const __m128i close_brace = _mm_set1_epi8('}');
+            for (; i + 16 <= length; i += 16)
+            {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, open_brace), _mm_cmpeq_epi8(block, close_brace))));
+                while (mask != 0)
+                {
+                    positions.push_back(i + count_trailing_zeros(mask));
+                    mask &= mask - 1;
+                }
+            }
+#endif // DTLOG_HAS_SSE2
+            for (; i < length; ++i)
+            {
+                if (str[i] == '{' || str[i] == '}')
+                    positions.push_back(i);
+            }
+        }
+
+        /**
+         * @brief A piece of a parsed format string: either literal text or an argument reference.
+         */
+        struct format_segment
+        {
+            static constexpr std::uint32_t literal = static_cast<std::uint32_t>(-1); ///< The index value of literal segments.
+
+            /**
+             * @brief Constructs a segment. Values are stored in 32 bits to keep cached segment lists compact.
+             * @param offset The offset of the text.
+             * @param length The length of the text.
+             * @param index The argument index, or literal. Larger indices are clamped and never match an argument.
+             */
+            format_segment(size_t offset, size_t length, size_t index)
+                : offset(static_cast<std::uint32_t>(offset)), length(static_cast<std::uint32_t>(length)), index(index <= literal ? static_cast<std::uint32_t>(index) : literal - 1) {}
+
+            std::uint32_t offset; ///< The offset of the text (literal) or of the format spec after ':' (argument).
+            std::uint32_t length; ///< The length of the text or of the format spec.
+            std::uint32_t index;  ///< The argument index, or literal.
+        };
+
+        /**
+         * @brief The list of segments of a parsed format string.
+         */
+        using segment_list = helper_vector<format_segment, 16>;
+
+#if DTLOG_USE_STD_FORMAT
+        /**
+         * @brief Checks whether std::format can write a type (its std::formatter specialization is enabled).
+         * @tparam _Ty The type to check.
+         */
+        template <class _Ty>
+        constexpr bool is_std_formattable_v = std::is_default_constructible_v<std::formatter<_Ty, char>>;
+
+        /**
+         * @brief Writes a value with std::format, passing the format spec of the placeholder through.
+         *
+         * A spec that is not valid for the type does not throw: the placeholder is written as "{:spec}" followed by the
+         * message of the std::format_error in brackets, as logf() does for a format string that does not match.
+         * @tparam _Ty The type of the value.
+         * @param out The output buffer.
+         * @param spec The text after ':' in the placeholder, for example ">8.3f".
+         * @param value The value to write.
+         */
+        template <class _Ty>
+        void std_format_to(format_buffer& out, std::string_view spec, const _Ty& value)
+        {
+            try
+            {
+                char pattern[64] = { '{', ':' };
+                if (spec.size() <= sizeof(pattern) - 3)
+                {
+                    std::memcpy(pattern + 2, spec.data(), spec.size());
+                    pattern[spec.size() + 2] = '}';
+                    std::vformat_to(std::back_inserter(out), std::string_view(pattern, spec.size() + 3), std::make_format_args(value));
+                    return;
+                }
+
+                // Longer specs, such as long chrono formats, are built in a buffer.
+                format_buffer field;
+                field.append("{:", 2);
+                field.append(spec);
+                field.push_back('}');
+                std::vformat_to(std::back_inserter(out), field.view(), std::make_format_args(value));
+            }
+            catch (const std::format_error& error)
+            {
+                out.append("{:", 2);
+                out.append(spec);
+                out.append("} [", 3);
+                out.append(std::string_view(error.what()));
+                out.push_back(']');
+            }
+        }
+#endif // DTLOG_USE_STD_FORMAT
+
+        /**
+         * @brief Hashes a block of characters, eight bytes per step.
+         * @param str Pointer to the first character.
+         * @param length The number of characters.
+         * @return The 64-bit hash of the characters.
+         */
+        inline unsigned long long hash_bytes(const char* str, size_t length)
+        {
+            constexpr unsigned long long multiplier = 0x9E3779B97F4A7C15ull;
+            unsigned long long hash = length * multiplier;
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8)
+            {
+                unsigned long long word;
+                std::memcpy(&word, str + i, 8);
+                hash = (hash ^ word) * multiplier;
+                hash ^= hash >> 29;
+            }
+            unsigned long long tail = 0;
+            if (i != length)
+                std::memcpy(&tail, str + i, length - i);
+            hash = (hash ^ tail) * multiplier;
+            return hash ^ (hash >> 32);
+        }
+
+        /**
+         * @brief Identifies a format string in the per-thread caches.
+         *
+         * The address and length pick the cache slot; a hash of the whole string, checked on every hit, catches a
+         * buffer that was overwritten in place with different text.
+         */
+        struct format_key
+        {
+            const char* data = nullptr;  ///< The address of the format string.
+            size_t length = 0;           ///< The length of the format string.
+            unsigned long long hash = 0; ///< The hash of the characters.
+
+            /**
+             * @brief Builds the key of a format string.
+             * @param fmt The format string.
+             * @return The key.
+             */
+            static format_key of(std::string_view fmt)
+            {
+                return format_key{ fmt.data(), fmt.size(), hash_bytes(fmt.data(), fmt.size()) };
+            }
+
+            /**
+             * @brief Picks a cache slot from the address and length.
+             * @param slot_count The number of slots, a power of two.
+             * @return The slot index.
+             */
+            size_t slot(size_t slot_count) const
+            {
+                const size_t key_bits = static_cast<size_t>(reinterpret_cast<std::uintptr_t>(data) >> 3) ^ length;
+                return (key_bits * 0x9E3779B9u >> 8) & (slot_count - 1);
+            }
+
+            bool operator==(const format_key& other) const
+            {
+                return data == other.data && length == other.length && hash == other.hash;
+            }
+
+            bool operator!=(const format_key& other) const
+            {
+                return !(*this == other);
+            }
+        };
+
+        /**
+         * @brief Converts 16 bytes into 32 lowercase hexadecimal digits.
+         * @param bytes Pointer to the 16 input bytes.
+         * @param digits Pointer to the 32 output characters.
+         */
+        inline void bytes_to_hex16(const unsigned char* bytes, char* digits)
+        {
+#if DTLOG_HAS_SSE2
+            const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+            const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+            const __m128i high = _mm_and_si128(_mm_srli_epi16(input, 4), nibble_mask);
+            const __m128i low = _mm_and_si128(input, nibble_mask);
+
+            // digit = nibble + '0', plus ('a' - '0' - 10) for nibbles above 9.
+            const __m128i nine = _mm_set1_epi8(9);
+            const __m128i zero_char = _mm_set1_epi8('0');
+            const __m128i letter_offset = _mm_set1_epi8('a' - '0' - 10);
+            const __m128i high_digits = _mm_add_epi8(_mm_add_epi8(high, zero_char), _mm_and_si128(_mm_cmpgt_epi8(high, nine), letter_offset));
+            const __m128i low_digits = _mm_add_epi8(_mm_add_epi8(low, zero_char), _mm_and_si128(_mm_cmpgt_epi8(low, nine), letter_offset));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(digits), _mm_unpacklo_epi8(high_digits, low_digits));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(digits + 16), _mm_unpackhi_epi8(high_digits, low_digits));
+#else // !DTLOG_HAS_SSE2
+            static constexpr char hex_digits[] = "0123456789abcdef";
+            for (size_t i = 0; i < 16; ++i)
+            {
+                digits[i * 2] = hex_digits[bytes[i] >> 4];
+                digits[i * 2 + 1] = hex_digits[bytes[i] & 0x0F];
+            }
+#endif // DTLOG_HAS_SSE2
+        }
+
+        /**
+         * @brief Replaces the non-printable bytes of a 16 byte block with '.'.
+         * @param bytes Pointer to the 16 input bytes.
+         * @param text Pointer to the 16 output characters.
+         */
+        inline void bytes_to_printable16(const unsigned char* bytes, char* text)
+        {
+#if DTLOG_HAS_SSE2
+            const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+            // Signed compares: bytes above 0x7F are negative and fail the first test.
+            const __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8(0x1F)), _mm_cmplt_epi8(input, _mm_set1_epi8(0x7F)));
+            const __m128i result = _mm_or_si128(_mm_and_si128(printable, input), _mm_andnot_si128(printable, _mm_set1_epi8('.')));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(text), result);
+#else // !DTLOG_HAS_SSE2
+            for (size_t i = 0; i < 16; ++i)
+                text[i] = (bytes[i] >= 0x20 && bytes[i] < 0x7F) ? static_cast<char>(bytes[i]) : '.';
+#endif // DTLOG_HAS_SSE2
+        }
+    } // namespace detail
+
+    /**
+     * @brief An argument type that formats a block of bytes as a classic offset/hex/ASCII dump.
+     *
+     * Each row of 16 bytes is written on its own line, in the layout of `hexdump -C`.
+     * At most max_bytes bytes are dumped; the number of omitted bytes is written after the last row.
+     */
+    class hexdump
+    {
+    public:
+        static constexpr size_t default_max_bytes = 4096; ///< The default number of bytes dumped.
+
+        /**
+         * @brief Constructs a dump of a raw memory block.
+         * @param data Pointer to the first byte.
+         * @param size The number of bytes.
+         * @param max_bytes The maximum number of bytes to dump.
+         */
+        hexdump(const void* data, size_t size, size_t max_bytes = default_max_bytes)
+            : m_data(static_cast<const unsigned char*>(data)), m_size(size), m_max_bytes(max_bytes) {}
+
+        /**
+         * @brief Constructs a dump of a contiguous container, such as std::vector, std::array or std::span.
+         * @tparam _Container The type of the container.
+         * @param bytes The container to dump.
+         * @param max_bytes The maximum number of bytes to dump.
+         */
+        template <class _Container, class = std::enable_if_t<detail::is_contiguous_range<_Container>::value && !std::is_array_v<_Container>>>
+        explicit hexdump(const _Container& bytes, size_t max_bytes = default_max_bytes)
+            : m_data(reinterpret_cast<const unsigned char*>(std::data(bytes))), m_size(std::size(bytes) * sizeof(*std::data(bytes))), m_max_bytes(max_bytes) {}
+
+        /**
+         * @brief Gets a pointer to the first byte.
+         * @return Pointer to the first byte.
+         */
+        const unsigned char* data() const
+        {
+            return m_data;
+        }
+
+        /**
+         * @brief Gets the number of bytes in the block.
+         * @return The number of bytes.
+         */
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        /**
+         * @brief Gets the maximum number of bytes to dump.
+         * @return The maximum number of bytes.
+         */
+        size_t max_bytes() const
+        {
+            return m_max_bytes;
+        }
+
+    private:
+        const unsigned char* m_data; ///< Pointer to the first byte.
+        size_t m_size;               ///< The number of bytes in the block.
+        size_t m_max_bytes;          ///< The maximum number of bytes to dump.
+    };
+
+    namespace detail
+    {
+        /**
+         * @brief The argument categories printf conversions are checked against.
+         */
+        enum class printf_kind
+        {
+            signed_integer,   ///< A signed integer or character.
+            unsigned_integer, ///< An unsigned integer, character or bool.
+            floating,         ///< A floating point value.
+            string,           ///< A C string or a type convertible to std::string_view.
+            pointer,          ///< Any other pointer, or nullptr.
+            unsupported       ///< A type printf_format cannot write.
+        };
+
+        /**
+         * @brief Gets the printf category of an argument type.
+         * @tparam _Ty The argument type.
+         * @return The category of the type.
+         */
+        template <class _Ty>
+        constexpr printf_kind printf_kind_of()
+        {
+            using value_type = std::remove_cv_t<std::remove_reference_t<_Ty>>;
+            using decayed_type = std::decay_t<_Ty>;
+            if constexpr (std::is_same_v<value_type, bool>)
+                return printf_kind::unsigned_integer;
+            else if constexpr (std::is_integral_v<value_type>)
+                return std::is_signed_v<value_type> ? printf_kind::signed_integer : printf_kind::unsigned_integer;
+            else if constexpr (std::is_floating_point_v<value_type>)
+                return printf_kind::floating;
+            else if constexpr (is_c_string_v<decayed_type> || std::is_convertible_v<const value_type&, std::string_view>)
+                return printf_kind::string;
+            else if constexpr (std::is_pointer_v<decayed_type> || std::is_null_pointer_v<value_type>)
+                return printf_kind::pointer;
+            else
+                return printf_kind::unsupported;
+        }
+
+        /**
+         * @brief A parsed printf conversion specification.
+         */
+        struct printf_spec
+        {
+            char conversion = '\0';  ///< The conversion character.
+            bool left = false;       ///< The '-' flag.
+            bool plus = false;       ///< The '+' flag.
+            bool space = false;      ///< The ' ' flag.
+            bool alternate = false;  ///< The '#' flag.
+            bool zero = false;       ///< The '0' flag.
+            int width = 0;           ///< The minimum field width.
+            int precision = -1;      ///< The precision, or -1 if none was given.
+        };
+
+        /**
+         * @brief Parses the conversion specification that follows a '%'.
+         *
+         * Length modifiers are accepted and ignored, since the argument types are known.
+         * @param fmt The format string.
+         * @param pos The position after the '%'; receives the position after the conversion character.
+         * @param spec Receives the specification.
+         * @return nullptr, or a description of the error.
+         */
+        constexpr const char* parse_printf_spec(std::string_view fmt, size_t& pos, printf_spec& spec)
+        {
+            for (; pos < fmt.size(); ++pos)
+            {
+                const char c = fmt[pos];
+                if (c == '-') spec.left = true;
+                else if (c == '+') spec.plus = true;
+                else if (c == ' ') spec.space = true;
+                else if (c == '#') spec.alternate = true;
+                else if (c == '0') spec.zero = true;
+                else break;
+            }
+            for (; pos < fmt.size() && fmt[pos] >= '0' && fmt[pos] <= '9'; ++pos)
+            {
+                spec.width = spec.width * 10 + (fmt[pos] - '0');
+                if (spec.width > 4096)
+                    return "dtlog::printf_format: the field width is limited to 4096";
+            }
+            if (pos < fmt.size() && fmt[pos] == '.')
+            {
+                spec.precision = 0;
+                for (++pos; pos < fmt.size() && fmt[pos] >= '0' && fmt[pos] <= '9'; ++pos)
+                {
+                    spec.precision = spec.precision * 10 + (fmt[pos] - '0');
+                    if (spec.precision > 99)
+                        return "dtlog::printf_format: the precision is limited to 99";
+                }
+            }
+            if (pos < fmt.size() && fmt[pos] == '*')
+                return "dtlog::printf_format: '*' width and precision are not supported";
+            while (pos < fmt.size() && (fmt[pos] == 'h' || fmt[pos] == 'l' || fmt[pos] == 'j' || fmt[pos] == 'z' || fmt[pos] == 't' || fmt[pos] == 'L'))
+                ++pos;
+            if (pos == fmt.size())
+                return "dtlog::printf_format: incomplete conversion specification";
+
+            spec.conversion = fmt[pos++];
+            if (spec.conversion == 'n')
+                return "dtlog::printf_format: %n is not supported";
+            if (std::string_view("diuoxXfFeEgGaAcsp%").find(spec.conversion) == std::string_view::npos)
+                return "dtlog::printf_format: unknown conversion";
+            return nullptr;
+        }
+
+        /**
+         * @brief Checks whether a conversion accepts an argument category.
+         * @param conversion The conversion character.
+         * @param kind The category of the argument.
+         * @return True if the argument can be written by the conversion.
+         */
+        constexpr bool printf_accepts(char conversion, printf_kind kind)
+        {
+            switch (conversion)
+            {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+                return kind == printf_kind::signed_integer || kind == printf_kind::unsigned_integer;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                return kind == printf_kind::floating;
+            case 's':
+                return kind == printf_kind::string;
+            case 'p':
+                return kind == printf_kind::pointer || kind == printf_kind::string;
+            default:
+                return false;
+            }
+        }
+
+        /**
+         * @brief Checks a printf format string against the categories of its arguments.
+         * @param fmt The format string.
+         * @param kinds The categories of the arguments.
+         * @param count The number of arguments.
+         * @return nullptr, or a description of the first error.
+         */
+        constexpr const char* check_printf(std::string_view fmt, const printf_kind* kinds, size_t count)
+        {
+            size_t next = 0;
+            for (size_t pos = 0; pos < fmt.size();)
+            {
+                if (fmt[pos++] != '%')
+                    continue;
+                printf_spec spec;
+                if (const char* error = parse_printf_spec(fmt, pos, spec))
+                    return error;
+                if (spec.conversion == '%')
+                    continue;
+                if (next == count)
+                    return "dtlog::printf_format: more conversions than arguments";
+                if (!printf_accepts(spec.conversion, kinds[next++]))
+                    return "dtlog::printf_format: a conversion does not match the type of its argument";
+            }
+            return next == count ? nullptr : "dtlog::printf_format: more arguments than conversions";
+        }
+
+        /**
+         * @brief A printf argument, converted once so the renderer is not a template.
+         */
+        struct printf_argument
+        {
+            long long signed_value = 0;             ///< Integers, as the signed type of their size.
+            unsigned long long unsigned_value = 0;  ///< Integers, as the unsigned type of their size.
+            long double floating_value = 0;         ///< Floating point values.
+            bool long_double = false;               ///< Whether the floating point value is a long double.
+            std::string_view string_value;          ///< Strings.
+            const void* pointer_value = nullptr;    ///< Pointers.
+        };
+
+        /**
+         * @brief Converts an argument for the printf renderer.
+         * @tparam _Ty The argument type.
+         * @param value The argument.
+         * @return The converted argument.
+         */
+        template <class _Ty>
+        printf_argument make_printf_argument(const _Ty& value)
+        {
+            using value_type = std::remove_cv_t<_Ty>;
+            using decayed_type = std::decay_t<_Ty>;
+            static_assert(printf_kind_of<_Ty>() != printf_kind::unsupported, "dtlog::printf_format: unsupported argument type.");
+
+            printf_argument argument;
+            if constexpr (std::is_same_v<value_type, bool>)
+            {
+                argument.signed_value = value ? 1 : 0;
+                argument.unsigned_value = value ? 1 : 0;
+            }
+            else if constexpr (std::is_integral_v<value_type>)
+            {
+                // Integers narrower than int are promoted first, as they are when passed to printf.
+                using promoted_type = decltype(+value);
+                const promoted_type promoted = value;
+                argument.signed_value = static_cast<long long>(static_cast<std::make_signed_t<promoted_type>>(promoted));
+                argument.unsigned_value = static_cast<unsigned long long>(static_cast<std::make_unsigned_t<promoted_type>>(promoted));
+            }
+            else if constexpr (std::is_floating_point_v<value_type>)
+            {
+                argument.floating_value = value;
+                argument.long_double = std::is_same_v<value_type, long double>;
+            }
+            else if constexpr (is_c_string_v<decayed_type>)
+            {
+                const std::remove_pointer_t<decayed_type>* str = value;
+                argument.pointer_value = str;
+                argument.string_value = str ? std::string_view(reinterpret_cast<const char*>(str)) : std::string_view("(null)");
+            }
+            else if constexpr (std::is_convertible_v<const value_type&, std::string_view>)
+                argument.string_value = std::string_view(value);
+            else if constexpr (std::is_pointer_v<decayed_type>)
+                argument.pointer_value = reinterpret_cast<const void*>(static_cast<decayed_type>(value));
+            return argument;
+        }
+
+        /**
+         * @brief Appends a field padded to the width of a specification.
+         * @param out The output buffer.
+         * @param spec The specification.
+         * @param prefix The sign and base prefix, written before any zero padding.
+         * @param body The digits or text.
+         * @param zero_digits The number of zeros required by an integer precision.
+         * @param zero_pad True if the '0' flag applies to this field.
+         */
+        inline void write_printf_field(format_buffer& out, const printf_spec& spec, std::string_view prefix, std::string_view body, size_t zero_digits, bool zero_pad)
+        {
+            const size_t length = prefix.size() + zero_digits + body.size();
+            const size_t padding = static_cast<size_t>(spec.width) > length ? static_cast<size_t>(spec.width) - length : 0;
+            if (spec.left)
+                zero_pad = false;
+            if (!spec.left && !zero_pad)
+                for (size_t i = 0; i < padding; ++i)
+                    out.push_back(' ');
+            out.append(prefix);
+            for (size_t i = 0; i < zero_digits + (zero_pad ? padding : 0); ++i)
+                out.push_back('0');
+            out.append(body);
+            if (spec.left)
+                for (size_t i = 0; i < padding; ++i)
+                    out.push_back(' ');
+        }
+
+        /**
+         * @brief Appends a floating point argument with std::snprintf, for specifications std::to_chars cannot write.
+         * @param out The output buffer.
+         * @param spec The specification.
+         * @param argument The converted argument.
+         */
+        inline void write_printf_floating_fallback(format_buffer& out, const printf_spec& spec, const printf_argument& argument)
+        {
+            char conversion[16] = { '%' };
+            size_t length = 1;
+            if (spec.left) conversion[length++] = '-';
+            if (spec.plus) conversion[length++] = '+';
+            if (spec.space) conversion[length++] = ' ';
+            if (spec.alternate) conversion[length++] = '#';
+            if (spec.zero) conversion[length++] = '0';
+            conversion[length++] = '*';
+            conversion[length++] = '.';
+            conversion[length++] = '*';
+            if (argument.long_double)
+                conversion[length++] = 'L';
+            conversion[length++] = spec.conversion;
+
+            const int precision = spec.precision < 0 ? 6 : spec.precision;
+            const auto print = [&](char* first, size_t size)
+            {
+                return argument.long_double
+                    ? std::snprintf(first, size, conversion, spec.width, precision, argument.floating_value)
+                    : std::snprintf(first, size, conversion, spec.width, precision, static_cast<double>(argument.floating_value));
+            };
+            const int needed = print(nullptr, 0);
+            if (needed <= 0)
+                return;
+            if (needed < 128)
+            {
+                char* first = out.prepare(static_cast<size_t>(needed) + 1);
+                print(first, static_cast<size_t>(needed) + 1);
+                out.commit(static_cast<size_t>(needed));
+            }
+            else
+            {
+                std::string text(static_cast<size_t>(needed) + 1, '\0');
+                print(&text[0], text.size());
+                out.append(text.data(), static_cast<size_t>(needed));
+            }
+        }
+
+        /**
+         * @brief Appends one converted argument as a printf conversion would.
+         * @param out The output buffer.
+         * @param spec The specification.
+         * @param argument The argument.
+         */
+        inline void write_printf_argument(format_buffer& out, const printf_spec& spec, const printf_argument& argument)
+        {
+            char digits[160];
+            char* const end = digits + sizeof(digits);
+            char* begin = end;
+            const bool upper = spec.conversion == 'X' || spec.conversion == 'F' || spec.conversion == 'E' || spec.conversion == 'G' || spec.conversion == 'A';
+
+            switch (spec.conversion)
+            {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'p':
+            {
+                const char* sign = "";
+                unsigned long long magnitude = argument.unsigned_value;
+                if (spec.conversion == 'd' || spec.conversion == 'i')
+                {
+                    magnitude = argument.signed_value < 0 ? 0ULL - static_cast<unsigned long long>(argument.signed_value) : static_cast<unsigned long long>(argument.signed_value);
+                    sign = argument.signed_value < 0 ? "-" : spec.plus ? "+" : spec.space ? " " : "";
+                }
+                else if (spec.conversion == 'p')
+                    magnitude = static_cast<unsigned long long>(reinterpret_cast<std::uintptr_t>(argument.pointer_value));
+
+                if (spec.conversion == 'd' || spec.conversion == 'i' || spec.conversion == 'u')
+                {
+                    if (magnitude != 0 || spec.precision != 0)
+                        begin = write_unsigned_backwards(end, magnitude);
+                }
+                else
+                {
+                    const unsigned shift = spec.conversion == 'o' ? 3 : 4;
+                    const char* alphabet = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+                    for (unsigned long long rest = magnitude; rest != 0; rest >>= shift)
+                        *--begin = alphabet[rest & ((1ULL << shift) - 1)];
+                    if (begin == end && spec.precision != 0)
+                        *--begin = '0';
+                }
+
+                const size_t digit_count = static_cast<size_t>(end - begin);
+                size_t zero_digits = spec.precision > 0 && static_cast<size_t>(spec.precision) > digit_count ? static_cast<size_t>(spec.precision) - digit_count : 0;
+                std::string_view prefix(sign);
+                if (spec.conversion == 'p')
+                    prefix = "0x";
+                else if (spec.alternate && (spec.conversion == 'x' || spec.conversion == 'X') && magnitude != 0)
+                    prefix = upper ? "0X" : "0x";
+                else if (spec.alternate && spec.conversion == 'o' && zero_digits == 0 && (begin == end || *begin != '0'))
+                    zero_digits = 1;
+                write_printf_field(out, spec, prefix, std::string_view(begin, digit_count), zero_digits, spec.zero && spec.precision < 0);
+                break;
+            }
+            case 'c':
+            {
+                const char c = static_cast<char>(argument.unsigned_value);
+                write_printf_field(out, spec, std::string_view(), std::string_view(&c, 1), 0, false);
+                break;
+            }
+            case 's':
+            {
+                std::string_view str = argument.string_value;
+                if (spec.precision >= 0 && static_cast<size_t>(spec.precision) < str.size())
+                    str = str.substr(0, static_cast<size_t>(spec.precision));
+                write_printf_field(out, spec, std::string_view(), str, 0, false);
+                break;
+            }
+            default:
+            {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+                if (spec.alternate)
+                {
+                    write_printf_floating_fallback(out, spec, argument);
+                    break;
+                }
+                const long double value = argument.floating_value;
+                const int precision = spec.precision < 0 ? 6 : spec.precision;
+                std::chars_format format = std::chars_format::hex;
+                switch (spec.conversion)
+                {
+                case 'f': case 'F': format = std::chars_format::fixed; break;
+                case 'e': case 'E': format = std::chars_format::scientific; break;
+                case 'g': case 'G': format = std::chars_format::general; break;
+                default: break;
+                }
+                // Doubles are converted as doubles, so %a shows the same mantissa as printf.
+                std::to_chars_result result{};
+                if (format == std::chars_format::hex && spec.precision < 0)
+                    result = argument.long_double ? std::to_chars(digits, end, value, format) : std::to_chars(digits, end, static_cast<double>(value), format);
+                else
+                    result = argument.long_double ? std::to_chars(digits, end, value, format, precision) : std::to_chars(digits, end, static_cast<double>(value), format, precision);
+                if (result.ec != std::errc())
+                {
+                    write_printf_floating_fallback(out, spec, argument);
+                    break;
+                }
+
+                begin = digits;
+                const bool negative = *begin == '-';
+                if (negative)
+                    ++begin;
+                if (upper)
+                    for (char* c = begin; c != result.ptr; ++c)
+                        if (*c >= 'a' && *c <= 'z')
+                            *c = static_cast<char>(*c - 'a' + 'A');
+
+                const bool finite = value - value == 0;
+                char prefix[3] = { '\0', '\0', '\0' };
+                size_t prefix_length = 0;
+                if (negative || spec.plus || spec.space)
+                    prefix[prefix_length++] = negative ? '-' : spec.plus ? '+' : ' ';
+                if ((spec.conversion == 'a' || spec.conversion == 'A') && finite)
+                {
+                    prefix[prefix_length++] = '0';
+                    prefix[prefix_length++] = upper ? 'X' : 'x';
+                }
+                write_printf_field(out, spec, std::string_view(prefix, prefix_length), std::string_view(begin, static_cast<size_t>(result.ptr - begin)), 0, spec.zero && finite);
+#else // !__cpp_lib_to_chars
+                write_printf_floating_fallback(out, spec, argument);
+#endif // __cpp_lib_to_chars
+                break;
+            }
+            }
+        }
+
+        /**
+         * @brief Appends a printf format string that does not match its arguments, followed by the error in brackets.
+         * @param out The output buffer.
+         * @param fmt The format string.
+         * @param error The description of the error.
+         */
+        inline void write_printf_error(format_buffer& out, std::string_view fmt, const char* error)
+        {
+            out.append(fmt);
+            out.append(" [", 2);
+            out.append(std::string_view(error));
+            out.push_back(']');
+        }
+
+        /**
+         * @brief The base of the types DTLOG_PRINTF wraps string literals in.
+         */
+        struct compile_time_printf_string {};
+
+        /**
+         * @brief Appends a checked printf format string with its converted arguments.
+         * @param out The output buffer.
+         * @param fmt The format string.
+         * @param arguments The converted arguments.
+         * @param count The number of arguments.
+         */
+        inline void write_printf(format_buffer& out, std::string_view fmt, const printf_argument* arguments, size_t count)
+        {
+            size_t next = 0;
+            size_t pos = 0;
+            while (pos < fmt.size())
+            {
+                const char* percent = static_cast<const char*>(std::memchr(fmt.data() + pos, '%', fmt.size() - pos));
+                if (!percent)
+                    break;
+                const size_t at = static_cast<size_t>(percent - fmt.data());
+                out.append(fmt.data() + pos, at - pos);
+                pos = at + 1;
+
+                printf_spec spec;
+                if (parse_printf_spec(fmt, pos, spec) != nullptr || (spec.conversion != '%' && next == count))
+                {
+                    out.append(fmt.data() + at, fmt.size() - at);
+                    return;
+                }
+                if (spec.conversion == '%')
+                    out.push_back('%');
+                else
+                    write_printf_argument(out, spec, arguments[next++]);
+            }
+            if (pos < fmt.size())
+                out.append(fmt.data() + pos, fmt.size() - pos);
+        }
+    } // namespace detail
+
+    /**
+     * @brief Marks a printf format string that is only known at run time.
+     */
+    struct runtime_printf_format
+    {
+        std::string_view text; ///< The format string.
+    };
+
+    /**
+     * @brief Wraps a printf format string that is only known at run time, so it is checked when the record is logged.
+     * @param fmt The format string.
+     * @return The wrapped format string.
+     */
+    inline runtime_printf_format runtime_printf(std::string_view fmt)
+    {
+        return runtime_printf_format{ fmt };
+    }
+
+    /**
+     * @brief A printf format string checked against the types of its arguments.
+     *
+     * With C++20 string literals are checked at compile time and a mismatch does not compile. With C++17 the same
+     * compile-time check needs the literal wrapped in DTLOG_PRINTF("..."); a bare literal, like a string given with
+     * runtime_printf(), is checked when it is first logged and the result is cached per thread. A format string that
+     * does not match is logged as written, followed by the error in brackets; logging never throws because of it.
+     * The conversions d i u o x X c f F e E g G a A s p and %% are supported with the flags, width and precision of
+     * printf; '*' and %n are not.
+     * @tparam _Args The argument types.
+     */
+    template <class ..._Args>
+    class printf_format
+    {
+    public:
+        /**
+         * @brief Checks a format string.
+         * @tparam _Str A type convertible to std::string_view (a string literal).
+         * @param fmt The format string.
+         */
+        template <class _Str, class = std::enable_if_t<std::is_convertible_v<const _Str&, std::string_view>>>
+        DTLOG_CONSTEVAL printf_format(const _Str& fmt) : m_format(fmt), m_error(nullptr)
+        {
+#if DTLOG_HAS_CONSTEVAL
+            // Throwing is not a constant expression, so a mismatch stops the compilation here.
+            if (const char* error = check(m_format))
+                throw std::invalid_argument(error);
+#else // DTLOG_HAS_CONSTEVAL
+            m_error = cached_check(m_format);
+#endif // DTLOG_HAS_CONSTEVAL
+        }
+
+        /**
+         * @brief Takes a string literal wrapped in DTLOG_PRINTF and checks it at compile time.
+         * @tparam _Str The type DTLOG_PRINTF made for the literal.
+         */
+        template <class _Str, class = std::enable_if_t<std::is_base_of_v<detail::compile_time_printf_string, _Str>>, class = void>
+        constexpr printf_format(_Str) : m_format(_Str::get()), m_error(nullptr)
+        {
+            static_assert(check(_Str::get()) == nullptr, "dtlog::printf_format: the format string does not match the arguments.");
+        }
+
+        /**
+         * @brief Checks a format string that is only known at run time.
+         * @param fmt The format string.
+         */
+        printf_format(runtime_printf_format fmt) : m_format(fmt.text), m_error(cached_check(fmt.text)) {}
+
+        /**
+         * @brief Gets the format string.
+         * @return The format string.
+         */
+        DTLOG_NODISCARD constexpr std::string_view get() const
+        {
+            return m_format;
+        }
+
+        /**
+         * @brief Gets the error found in the format string.
+         * @return nullptr if the format string matches the arguments, or a description of the first error.
+         */
+        DTLOG_NODISCARD constexpr const char* error() const
+        {
+            return m_error;
+        }
+
+    private:
+        /**
+         * @brief Checks a format string against the argument types.
+         * @param fmt The format string.
+         * @return nullptr, or a description of the first error.
+         */
+        static constexpr const char* check(std::string_view fmt)
+        {
+            constexpr detail::printf_kind kinds[sizeof...(_Args) + 1] = { detail::printf_kind_of<_Args>()..., detail::printf_kind::unsupported };
+            return detail::check_printf(fmt, kinds, sizeof...(_Args));
+        }
+
+        /**
+         * @brief Checks a format string, reusing the result of an earlier check of the same string on this thread.
+         * @param fmt The format string.
+         * @return nullptr, or a description of the first error.
+         */
+        static const char* cached_check(std::string_view fmt)
+        {
+            struct entry
+            {
+                detail::format_key key;       ///< The format string that was checked.
+                const char* error = nullptr;  ///< The result of the check.
+            };
+            constexpr size_t slot_count = 16;
+            thread_local entry entries[slot_count];
+
+            const detail::format_key key = detail::format_key::of(fmt);
+            entry& slot = entries[key.slot(slot_count)];
+            if (slot.key != key)
+            {
+                slot.error = check(fmt);
+                slot.key = key;
+            }
+            return slot.error;
+        }
+
+        std::string_view m_format; ///< The format string.
+        const char* m_error;       ///< The error found in the format string, or nullptr.
+    };
+
+    /**
+     * @brief A utility class for formatting strings.
+     */
+    class formatter
+    {
+    public:
+        /**
+         * @brief Formats a string with the given arguments.
+         * @tparam _Args The types of the arguments.
+         * @param fmt The format string.
+         * @param args The arguments to format into the string.
+         * @return The formatted string.
+         */
+        template <typename... _Args>
+        DTLOG_NODISCARD static std::string format(std::string_view fmt, _Args&&... args)
+        {
+            if constexpr (sizeof...(args) == 0)
+            {
+                return std::string(fmt);
+            }
+            else
+            {
+                format_buffer out;
+                format_to(out, fmt, std::forward<_Args>(args)...);
+                return out.str();
+            }
+        }
+
+        /**
+         * @brief Formats a string with the given arguments and appends the result to a buffer.
+         * @tparam _Args The types of the arguments.
+         * @param out The buffer to append to.
+         * @param fmt The format string.
+         * @param args The arguments to format into the string.
+         */
+        template <typename... _Args>
+        static void format_to(format_buffer& out, std::string_view fmt, _Args&&... args)
+        {
+            if constexpr (sizeof...(args) == 0)
+            {
+                out.append(fmt);
+            }
+            else
+            {
+                DTLOG_STAGE_START(capture_start);
+                argument_array<detail::argument_capture_t<_Args>...> argArray(detail::capture_argument<false>(std::forward<_Args>(args))...);
+                DTLOG_STAGE_STOP(capture, capture_start);
+
+                DTLOG_STAGE_SCOPE(format);
+                parse_cache::lease cached(parse_cache::thread_instance(), fmt);
+                if (cached)
+                {
+                    render(out, fmt, cached.segments(), argArray.data(), argArray.size());
+                }
+                else
+                {
+                    detail::segment_list segments;
+                    parse(fmt, segments);
+                    render(out, fmt, segments, argArray.data(), argArray.size());
+                }
+            }
+        }
+
+        /**
+         * @brief Overloaded function call operator to format strings.
+         * @tparam Args The types of the arguments.
+         * @param fmt The format string.
+         * @param args The arguments to format into the string.
+         * @return The formatted string.
+         */
+        template <typename... Args>
+        std::string operator()(std::string_view fmt, Args&&... args)
+        {
+            return format(fmt, std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Appends a single value to a buffer.
+         *
+         * Integers and floating point values are written with dedicated kernels, strings are copied
+         * directly, streamable types go through std::ostream and other ranges are written as
+         * [a, b, c] (maps as {k: v}), limited to get_max_range_elements() elements.
+         * @tparam _Ty The type of the value.
+         * @param out The buffer to append to.
+         * @param value The value to append.
+         */
+        template <class _Ty>
+        static void append(format_buffer& out, const _Ty& value)
+        {
+            using value_type = std::decay_t<_Ty>;
+
+            if constexpr (std::is_same_v<value_type, bool>)
+                out.push_back(value ? '1' : '0');
+            else if constexpr (detail::is_character_v<value_type>)
+                out.push_back(static_cast<char>(value));
+            else if constexpr (detail::is_integer_v<value_type>)
+                detail::write_integer(out, value);
+            else if constexpr (std::is_floating_point_v<value_type>)
+                detail::write_floating(out, value);
+            else if constexpr (detail::is_c_string_v<value_type>)
+            {
+                const char* str = reinterpret_cast<const char*>(static_cast<const std::remove_pointer_t<value_type>*>(value));
+                if (str)
+                    out.append(str, std::strlen(str));
+                else
+                    out.append("(null)", 6);
+            }
+            else if constexpr (std::is_convertible_v<const _Ty&, std::string_view> && !std::is_same_v<value_type, std::nullptr_t>)
+                out.append(std::string_view(value));
+            else if constexpr (std::is_same_v<value_type, hexdump>)
+                append_hexdump(out, value);
+            else if constexpr (detail::is_pair_v<value_type>)
+            {
+                out.push_back('(');
+                append(out, value.first);
+                out.append(", ", 2);
+                append(out, value.second);
+                out.push_back(')');
+            }
+            else if constexpr (std::is_array_v<_Ty> && detail::is_range<_Ty>::value)
+                append_range(out, value);
+            else if constexpr (detail::is_streamable<_Ty>::value)
+            {
+#if DTLOG_ALLOCATION_FREE
+                static_assert(detail::always_false_v<_Ty>, "dtlog::formatter: DTLOG_ALLOCATION_FREE rejects types that are formatted through std::ostream.");
+#endif // DTLOG_ALLOCATION_FREE
+                std::ostringstream oss;
+                oss << value;
+                out.append(oss.str());
+            }
+            else if constexpr (detail::is_range<_Ty>::value)
+                append_range(out, value);
+            else
+                static_assert(detail::always_false_v<_Ty>, "dtlog::formatter: the argument type is neither streamable nor a range.");
+        }
+
+        /**
+         * @brief Sets the maximum number of elements written for a range argument.
+         * @param count The maximum number of elements. Zero means no limit.
+         */
+        static void set_max_range_elements(size_t count)
+        {
+            s_max_range_elements.store(count, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Gets the maximum number of elements written for a range argument.
+         * @return The maximum number of elements. Zero means no limit.
+         */
+        DTLOG_NODISCARD static size_t get_max_range_elements()
+        {
+            return s_max_range_elements.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Appends a printf-style formatted string to a buffer, using the same kernels as format_to.
+         * @tparam _Args Variadic template for the arguments.
+         * @param out The buffer to append to.
+         * @param fmt The printf format string, checked against the argument types.
+         * @param args The arguments.
+         */
+        template <class ..._Args>
+        static void printf_to(format_buffer& out, printf_format<std::decay_t<_Args>...> fmt, const _Args&... args)
+        {
+            if (fmt.error())
+            {
+                detail::write_printf_error(out, fmt.get(), fmt.error());
+                return;
+            }
+            const detail::printf_argument arguments[sizeof...(_Args) + 1] = { detail::make_printf_argument(args)..., detail::printf_argument() };
+            detail::write_printf(out, fmt.get(), arguments, sizeof...(_Args));
+        }
+
+        /**
+         * @brief Initializes the per-thread parse cache of the calling thread, so the first format call does not.
+         */
+        static void preallocate_thread()
+        {
+            (void)parse_cache::thread_instance();
+        }
+
+    private:
+        /**
+         * @brief Base class for arguments used in formatting.
+         */
+        struct argument_base
+        {
+            argument_base() {}
+            virtual ~argument_base() {}
+            virtual void format(format_buffer&, std::string_view) {}
+        };
+
+        /**
+         * @brief Template class for holding arguments of various types.
+         * @tparam _Ty The captured type of the argument (see detail::argument_capture).
+         */
+        template <class _Ty>
+        class argument : public argument_base
+        {
+        public:
+            /**
+             * @brief Constructs an argument with the given value.
              * @param arg The value of the argument.
              */
-            argument(_Ty arg) : m_argument(arg) {}
+            argument(_Ty arg) : m_argument(std::forward<_Ty>(arg)) {}
+
+            /**
+             * @brief Destructor.
+             */
+            virtual ~argument() override {}
+
+            /**
+             * @brief Formats the argument into the output buffer.
+             *
+             * The format spec of the placeholder is used only by the std::format backend (DTLOG_USE_STD_FORMAT).
+             * @param out The output buffer.
+             * @param spec The text after ':' in the placeholder, or empty.
+             */
+            virtual void format(format_buffer& out, std::string_view spec) override
+            {
+#if DTLOG_USE_STD_FORMAT
+                using value_type = std::remove_cv_t<std::remove_reference_t<_Ty>>;
+                if constexpr (detail::is_std_formattable_v<value_type>)
+                {
+                    if constexpr (detail::is_c_string_v<value_type>)
+                    {
+                        if (!m_argument)
+                        {
+                            formatter::append(out, m_argument);
+                            return;
+                        }
+                    }
+                    detail::std_format_to(out, spec, m_argument);
+                    return;
+                }
+#endif // DTLOG_USE_STD_FORMAT
+                (void)spec;
+                formatter::append(out, m_argument);
+            }
+
+        private:
+            _Ty m_argument; ///< The value of the argument.
+        };
+
+        /**
+         * @brief Holds the captured arguments of one format call, together with an array of argument_base pointers to them.
+         *
+         * The array lives on the stack of the format call, so capturing arguments never allocates.
+         * @tparam _Ty The captured types of the arguments.
+         */
+        template <class... _Ty>
+        class argument_array
+        {
+        public:
+            /**
+             * @brief Constructs the arguments from their captured values.
+             * @tparam _Args The types of the captured values.
+             * @param args The captured values.
+             */
+            template <class... _Args>
+            explicit argument_array(_Args&&... args) : m_arguments(std::forward<_Args>(args)...)
+            {
+                bind(std::index_sequence_for<_Ty...>());
+            }
+
+            argument_array(const argument_array&) = delete;
+            argument_array& operator=(const argument_array&) = delete;
+
+            /**
+             * @brief Gets the argument pointers.
+             * @return Pointer to the first argument pointer.
+             */
+            argument_base* const* data() const
+            {
+                return m_pointers;
+            }
+
+            /**
+             * @brief Gets the number of arguments.
+             * @return The number of arguments.
+             */
+            static constexpr size_t size()
+            {
+                return sizeof...(_Ty);
+            }
+
+        private:
+            template <size_t... _Index>
+            void bind(std::index_sequence<_Index...>)
+            {
+                ((m_pointers[_Index] = &std::get<_Index>(m_arguments)), ...);
+            }
+
+        private:
+            std::tuple<argument<_Ty>...> m_arguments;       ///< The arguments.
+            argument_base* m_pointers[sizeof...(_Ty) ? sizeof...(_Ty) : 1] = {}; ///< Pointers to the arguments, in order. Zero-length arrays are not valid C++.
+        };
+
+        /**
+         * @brief A small thread-local cache of parsed format strings.
+         *
+         * Entries are keyed by the address and length of the format string, so repeated calls with the
+         * same literal or the same stored template skip parsing. A hash of the contents is kept with each
+         * entry and checked on every hit, which catches a buffer that was reused for different text.
+         */
+        class parse_cache
+        {
+            struct entry;
+
+        public:
+            static constexpr size_t slot_count = 64; ///< The number of cache slots (a power of two).
+
+            /**
+             * @brief Gives access to the cached segments of a format string for the duration of a call.
+             *
+             * The slot is marked busy while the lease lives, so a format call made from inside an argument's
+             * operator<< cannot replace segments that are still being rendered; such a call gets an empty lease.
+             */
+            class lease
+            {
+            public:
+                /**
+                 * @brief Looks up the format string, parsing it into its slot on a miss.
+                 * @param cache The cache to use.
+                 * @param fmt The format string.
+                 */
+                lease(parse_cache& cache, std::string_view fmt) : m_entry(cache.acquire(fmt)) {}
+
+                /**
+                 * @brief Releases the slot.
+                 */
+                ~lease()
+                {
+                    if (m_entry)
+                        m_entry->busy = false;
+                }
+
+                lease(const lease&) = delete;
+                lease& operator=(const lease&) = delete;
+
+                /**
+                 * @brief Checks whether a slot could be used.
+                 */
+                explicit operator bool() const
+                {
+                    return m_entry != nullptr;
+                }
+
+                /**
+                 * @brief Gets the parsed segments.
+                 * @return The segments of the format string.
+                 */
+                const detail::segment_list& segments() const
+                {
+                    return m_entry->segments;
+                }
+
+            private:
+                entry* m_entry; ///< The leased slot, or nullptr.
+            };
+
+            /**
+             * @brief Gets the cache of the calling thread.
+             * @return The thread-local cache.
+             */
+            static parse_cache& thread_instance()
+            {
+                thread_local parse_cache cache;
+                return cache;
+            }
+
+        private:
+            struct entry
+            {
+                detail::format_key key;                         ///< The format string the segments belong to.
+                bool busy = false;                              ///< Whether a lease is active.
+                detail::segment_list segments{ nullptr }; ///< The parsed segments. The cache outlives any user resource, so it uses std::malloc.
+            };
+
+            /**
+             * @brief Finds or fills the slot of a format string.
+             * @param fmt The format string.
+             * @return The slot marked busy, or nullptr if the slot is already in use.
+             */
+            entry* acquire(std::string_view fmt)
+            {
+                const detail::format_key key = detail::format_key::of(fmt);
+                entry& slot = m_entries[key.slot(slot_count)];
+                if (slot.busy)
+                    return nullptr;
+
+                if (slot.key != key)
+                {
+                    slot.key = detail::format_key();
+                    slot.segments.clear();
+                    parse(fmt, slot.segments);
+                    slot.key = key;
+                }
+                slot.busy = true;
+                return &slot;
+            }
+
+        private:
+            entry m_entries[slot_count]; ///< The cache slots.
+        };
+
+        /**
+         * @brief Writes parsed segments, substituting the arguments.
+         * @param out The output buffer.
+         * @param fmt The format string the segments point into.
+         * @param segments The parsed segments.
+         * @param arguments Pointer to the first argument pointer.
+         * @param count The number of arguments.
+         */
+        static void render(format_buffer& out, std::string_view fmt, const detail::segment_list& segments, argument_base* const* arguments, size_t count)
+        {
+            out.reserve(out.size() + fmt.size());
+            for (const detail::format_segment& segment : segments)
+            {
+                if (segment.index == detail::format_segment::literal)
+                    out.append(fmt.data() + segment.offset, segment.length);
+                else if (segment.index < count)
+                    arguments[segment.index]->format(out, std::string_view(fmt.data() + segment.offset, segment.length));
+            }
+        }
+
+        /**
+         * @brief Splits a format string into literal and argument segments.
+         *
+         * "{{" produces a literal '{', "{N}" references argument N ("{}" references argument 0)
+         * and an unterminated '{' is kept as literal text. The text after ':' in "{N:spec}" is kept as the
+         * format spec of the argument segment.
+         * @param fmt The format string.
+         * @param segments Receives the segments.
+         */
+        static void parse(std::string_view fmt, detail::segment_list& segments)
+        {
+            helper_vector<size_t, 32> braces;
+            detail::find_braces(fmt.data(), fmt.size(), braces);
+
+            const size_t* brace = braces.begin();
+            const size_t* const last_brace = braces.end();
+            size_t start = 0;
+            while (true)
+            {
+                while (brace != last_brace && fmt[*brace] != '{')
+                    ++brace;
+                if (brace == last_brace)
+                {
+                    if (start < fmt.size())
+                        segments.emplace_back(start, fmt.size() - start, detail::format_segment::literal);
+                    break;
+                }
+
+                const size_t open = *brace++;
+                if (open > start)
+                    segments.emplace_back(start, open - start, detail::format_segment::literal);
+
+                if (open + 1 < fmt.size() && fmt[open + 1] == '{')
+                {
+                    segments.emplace_back(open, 1, detail::format_segment::literal);
+                    start = open + 2;
+                    ++brace;
+                    continue;
+                }
+
+                while (brace != last_brace && fmt[*brace] != '}')
+                    ++brace;
+                if (brace == last_brace)
+                {
+                    segments.emplace_back(open, fmt.size() - open, detail::format_segment::literal);
+                    break;
+                }
+
+                const size_t close = *brace++;
+                const std::string_view item = fmt.substr(open + 1, close - open - 1);
+                const size_t index = parse_index(item);
+                const size_t colon = item.find(':');
+                const size_t spec = colon == std::string_view::npos ? close : open + 2 + colon;
+                if (index != detail::format_segment::literal)
+                    segments.emplace_back(spec, close - spec, index);
+                start = close + 1;
+            }
+        }
+
+        /**
+         * @brief Reads the argument index at the beginning of a placeholder.
+         * @param item The text between the braces.
+         * @return The argument index; 0 when the item has no digits, format_segment::literal when it is negative.
+         */
+        static size_t parse_index(std::string_view item)
+        {
+            size_t pos = 0;
+            while (pos < item.size() && (item[pos] == ' ' || item[pos] == '\t'))
+                ++pos;
+            if (pos < item.size() && item[pos] == '-')
+                return detail::format_segment::literal;
+            if (pos < item.size() && item[pos] == '+')
+                ++pos;
+
+            size_t index = 0;
+            for (; pos < item.size() && item[pos] >= '0' && item[pos] <= '9'; ++pos)
+                index = index * 10 + static_cast<size_t>(item[pos] - '0');
+            return index;
+        }
+
+        /**
+         * @brief Writes the elements of a range, stopping after get_max_range_elements() elements.
+         * @tparam _Range The type of the range.
+         * @param out The output buffer.
+         * @param range The range to write.
+         */
+        template <class _Range>
+        static void append_range(format_buffer& out, const _Range& range)
+        {
+            using element_type = std::remove_cv_t<std::remove_reference_t<decltype(*std::begin(range))>>;
+            constexpr bool is_map = detail::is_map<_Range>::value && detail::is_pair_v<element_type>;
+            const size_t limit = get_max_range_elements();
+
+            if constexpr (!is_map && (detail::is_integer_v<element_type> || std::is_floating_point_v<element_type>) && detail::is_contiguous_range<_Range>::value)
+            {
+                append_numeric_span(out, std::data(range), static_cast<size_t>(std::size(range)), limit);
+                return;
+            }
+            else
+            {
+                out.push_back(is_map ? '{' : '[');
+                size_t count = 0;
+                auto it = std::begin(range);
+                const auto last = std::end(range);
+                for (; it != last; ++it, ++count)
+                {
+                    if (limit != 0 && count == limit)
+                        break;
+                    if (count != 0)
+                        out.append(", ", 2);
+                    if constexpr (is_map)
+                    {
+                        append(out, it->first);
+                        out.append(": ", 2);
+                        append(out, it->second);
+                    }
+                    else
+                    {
+                        append(out, *it);
+                    }
+                }
+                if (it != last)
+                    out.append(", ...", 5);
+                out.push_back(is_map ? '}' : ']');
+            }
+        }
+
+        /**
+         * @brief Writes a contiguous array of numbers without going through the generic element path.
+         * @tparam _Ty The element type.
+         * @param out The output buffer.
+         * @param values Pointer to the first element.
+         * @param count The number of elements.
+         * @param limit The maximum number of elements to write. Zero means no limit.
+         */
+        template <class _Ty>
+        static void append_numeric_span(format_buffer& out, const _Ty* values, size_t count, size_t limit)
+        {
+            const size_t written = (limit != 0 && count > limit) ? limit : count;
+            out.reserve(out.size() + written * 8 + 8);
+            out.push_back('[');
+            for (size_t i = 0; i < written; ++i)
+            {
+                if (i != 0)
+                    out.append(", ", 2);
+                if constexpr (std::is_floating_point_v<_Ty>)
+                    detail::write_floating(out, values[i]);
+                else
+                    detail::write_integer(out, values[i]);
+            }
+            if (written != count)
+                out.append(", ...", 5);
+            out.push_back(']');
+        }
+
+        /**
+         * @brief Writes a hex dump, 16 bytes per row.
+         * @param out The output buffer.
+         * @param dump The bytes to dump.
+         */
+        static void append_hexdump(format_buffer& out, const hexdump& dump)
+        {
+            constexpr size_t row_length = 79; // '\n' + offset(8) + 2 + 16 * 3 + 1 + 1 + '|' + 16 + '|'
+            const size_t count = dump.size() < dump.max_bytes() ? dump.size() : dump.max_bytes();
+            const unsigned char* bytes = dump.data();
+            out.reserve(out.size() + ((count + 15) / 16) * row_length + 32);
+
+            for (size_t offset = 0; offset < count; offset += 16)
+            {
+                const size_t row_size = (count - offset < 16) ? count - offset : 16;
+                unsigned char row[16] = {};
+                std::memcpy(row, bytes + offset, row_size);
+
+                char hex[32];
+                char text[16];
+                detail::bytes_to_hex16(row, hex);
+                detail::bytes_to_printable16(row, text);
+
+                char* line = out.prepare(row_length);
+                char* cursor = line;
+                *cursor++ = '\n';
+                for (size_t shift = 0; shift < 8; ++shift)
+                    *cursor++ = "0123456789abcdef"[(offset >> ((7 - shift) * 4)) & 0x0F];
+                *cursor++ = ' ';
+                for (size_t i = 0; i < 16; ++i)
+                {
+                    if (i == 8)
+                        *cursor++ = ' ';
+                    *cursor++ = ' ';
+                    if (i < row_size)
+                    {
+                        *cursor++ = hex[i * 2];
+                        *cursor++ = hex[i * 2 + 1];
+                    }
+                    else
+                    {
+                        *cursor++ = ' ';
+                        *cursor++ = ' ';
+                    }
+                }
+                *cursor++ = ' ';
+                *cursor++ = ' ';
+                *cursor++ = '|';
+                std::memcpy(cursor, text, row_size);
+                cursor += row_size;
+                *cursor++ = '|';
+                out.commit(static_cast<size_t>(cursor - line));
+            }
+
+            if (count < dump.size())
+            {
+                out.append("\n... (", 6);
+                detail::write_integer(out, dump.size() - count);
+                out.append(" more bytes)", 12);
+            }
+        }
+
+    private:
+        inline static std::atomic<size_t> s_max_range_elements{ 64 }; ///< The maximum number of range elements written.
+    };
+
+    /**
+ * @brief A utility class for formatting date and time strings.
+ */
+    class date_time_formatter
+    {
+    public:
+        /**
+         * @brief Default constructor.
+         * Initializes the formatter with the current local time.
+         */
+        date_time_formatter()
+        {
+            reset_time();
+        }
+
+        /**
+         * @brief Constructor that initializes the formatter with the specified time.
+         * @param timeptr Pointer to a std::tm structure representing the time.
+         */
+        explicit date_time_formatter(const std::tm* timeptr) : m_time(*timeptr) {}
+
+        /**
+         * @brief Constructor that initializes the formatter with a calendar time, converted to local time.
+         *
+         * Each thread keeps the last conversion, so the records of one second convert the time only once.
+         * @param time The calendar time, for example from a clock_source.
+         */
+        explicit date_time_formatter(std::time_t time)
+        {
+            thread_local bool cached = false;
+            thread_local std::time_t cached_time;
+            thread_local std::tm cached_local;
+            if (!cached || cached_time != time)
+            {
+                cached_local = local_time(time);
+                cached_time = time;
+                cached = true;
+            }
+            m_time = cached_local;
+        }
+
+        /**
+         * @brief Resets the time to the current local time.
+         */
+        void reset_time()
+        {
+            m_time = local_time(std::time(nullptr));
+        }
+
+        /**
+         * @brief Converts a calendar time to local time without the static buffer of std::localtime, so threads can call it concurrently.
+         * @param time The calendar time.
+         * @return The local time.
+         */
+        DTLOG_NODISCARD static std::tm local_time(std::time_t time)
+        {
+            std::tm result{};
+#ifdef _WIN32
+            localtime_s(&result, &time);
+#else // _WIN32
+            localtime_r(&time, &result);
+#endif // _WIN32
+            return result;
+        }
+
+        /**
+         * @brief Gets the full name of the weekday.
+         * @return The full name of the weekday.
+         */
+        DTLOG_NODISCARD std::string full_weekday_name() const
+        {
+            return std::string(weekdays(m_time.tm_wday));
+        }
+
+        /**
+         * @brief Gets the full name of the month.
+         * @return The full name of the month.
+         */
+        DTLOG_NODISCARD std::string full_month_name() const
+        {
+            return std::string(months(m_time.tm_mon));
+        }
+
+        /**
+         * @brief Gets the last two digits of the year.
+         * @return The last two digits of the year.
+         */
+        DTLOG_NODISCARD std::string year_2_digits() const
+        {
+            return std::to_string(m_time.tm_year % 100);
+        }
+
+        /**
+         * @brief Gets the full four digits of the year.
+         * @return The full four digits of the year.
+         */
+        DTLOG_NODISCARD std::string year_4_digits() const
+        {
+            return std::to_string(m_time.tm_year + 1900);
+        }
+
+        /**
+         * @brief Gets the date and time representation in a specific format.
+         * @return The formatted date and time string.
+         */
+        DTLOG_NODISCARD std::string date_time_representation() const
+        {
+            std::ostringstream oss;
+            oss << weekdays(m_time.tm_wday)
+                << " "
+                << months(m_time.tm_mon)
+                << " "
+                << m_time.tm_mday
+                << " "
+                << m_time.tm_year + 1900
+                << " "
+                << format_time(m_time.tm_hour)
+                << ":"
+                << format_time(m_time.tm_min)
+                << ":"
+                << format_time(m_time.tm_sec);
+            return oss.str();
+        }
+
+        /**
+         * @brief Gets the short date representation in MM/DD/YY format.
+         * @return The short date string.
+         */
+        DTLOG_NODISCARD std::string short_MMDDYY_date() const
+        {
+            std::ostringstream oss;
+            oss << format_time(m_time.tm_mon + 1)
+                << "/"
+                << format_time(m_time.tm_mday)
+                << "/"
+                << format_time((m_time.tm_year % 100));
+            return oss.str();
+        }
+
+        /**
+         * @brief Gets the month as a numeric string.
+         * @return The numeric representation of the month.
+         */
+        DTLOG_NODISCARD std::string month() const
+        {
+            return std::to_string(m_time.tm_mon + 1);
+        }
+
+        /**
+         * @brief Gets the day of the month as a string.
+         * @return The day of the month.
+         */
+        DTLOG_NODISCARD std::string day_of_month() const
+        {
+            return std::to_string(m_time.tm_mday);
+        }
+
+        /**
+         * @brief Gets the hours in 24-hour format.
+         * @return The hours in 24-hour format.
+         */
+        DTLOG_NODISCARD std::string hours_24_format() const
+        {
+            return std::to_string(m_time.tm_hour);
+        }
+
+        /**
+         * @brief Gets the hours in 12-hour format.
+         * @return The hours in 12-hour format.
+         */
+        DTLOG_NODISCARD std::string hours_12_format() const
+        {
+            int hours12 = m_time.tm_hour % 12;
+            if (hours12 == 0)
+                hours12 = 12;
+            return std::to_string(hours12);
+        }
+
+        /**
+         * @brief Gets the minutes as a string.
+         * @return The minutes.
+         */
+        DTLOG_NODISCARD std::string minutes() const
+        {
+            return std::to_string(m_time.tm_min);
+        }
+
+        /**
+         * @brief Gets the seconds as a
+         * string.
+         * @return The seconds.
+         */
+        DTLOG_NODISCARD std::string seconds() const
+        {
+            return std::to_string(m_time.tm_sec);
+        }
+
+        /**
+         * @brief Gets the AM/PM designation.
+         * @return "AM" if the time is before noon, "PM" otherwise.
+         */
+        DTLOG_NODISCARD std::string AM_PM() const
+        {
+            return (m_time.tm_hour < 12) ? "AM" : "PM";
+        }
+
+        /**
+         * @brief Gets the time in 12-hour clock format.
+         * @return The time in 12-hour format along with AM/PM designation.
+         */
+        DTLOG_NODISCARD std::string clock_12_hour() const
+        {
+            std::ostringstream oss;
+            oss << format_time((m_time.tm_hour % 12 == 0) ? 12 : m_time.tm_hour % 12)
+                << ":"
+                << format_time(m_time.tm_min)
+                << ":"
+                << format_time(m_time.tm_sec) << " "
+                << ((m_time.tm_hour < 12) ? "AM" : "PM");
+            return oss.str();
+        }
+
+        /**
+         * @brief Gets the time in HH:MM format (24-hour clock).
+         * @return The time in HH:MM format.
+         */
+        DTLOG_NODISCARD std::string HHMM_time_24_hour() const
+        {
+            std::ostringstream oss;
+            oss << format_time(m_time.tm_hour)
+                << ":"
+                << format_time(m_time.tm_min);
+            return oss.str();
+        }
+
+        /**
+         * @brief Gets the time in ISO 8601 format (HH:MM:SS).
+         * @return The time in ISO 8601 format.
+         */
+        DTLOG_NODISCARD std::string ISO8601_time_format() const
+        {
+            std::ostringstream oss;
+            oss << format_time(m_time.tm_hour)
+                << ":"
+                << format_time(m_time.tm_min)
+                << ":"
+                << format_time(m_time.tm_sec);
+            return oss.str();
+        }
+
+        /**
+         * @brief Appends the value of a pattern time token directly to a buffer, without building a string.
+         *
+         * The output is the same as that of the matching string method.
+         * @param out The buffer to append to.
+         * @param token The pattern token (one of A B C Y R D m d H h M S F x X T).
+         * @return False if token is not a time token.
+         */
+        bool append_token(format_buffer& out, char token) const
+        {
+            const int hours12 = (m_time.tm_hour % 12 == 0) ? 12 : m_time.tm_hour % 12;
+            switch (token)
+            {
+            case 'A': out.append(weekdays(m_time.tm_wday)); break;
+            case 'B': out.append(months(m_time.tm_mon)); break;
+            case 'C': append_number(out, m_time.tm_year % 100, 1); break;
+            case 'Y': append_number(out, m_time.tm_year + 1900, 1); break;
+            case 'R':
+                out.append(weekdays(m_time.tm_wday));
+                out.push_back(' ');
+                out.append(months(m_time.tm_mon));
+                out.push_back(' ');
+                append_number(out, m_time.tm_mday, 1);
+                out.push_back(' ');
+                append_number(out, m_time.tm_year + 1900, 1);
+                out.push_back(' ');
+                append_clock(out, m_time.tm_hour, true);
+                break;
+            case 'D':
+                append_number(out, m_time.tm_mon + 1, 2);
+                out.push_back('/');
+                append_number(out, m_time.tm_mday, 2);
+                out.push_back('/');
+                append_number(out, m_time.tm_year % 100, 2);
+                break;
+            case 'm': append_number(out, m_time.tm_mon + 1, 1); break;
+            case 'd': append_number(out, m_time.tm_mday, 1); break;
+            case 'H': append_number(out, m_time.tm_hour, 1); break;
+            case 'h': append_number(out, hours12, 1); break;
+            case 'M': append_number(out, m_time.tm_min, 1); break;
+            case 'S': append_number(out, m_time.tm_sec, 1); break;
+            case 'F': out.append(m_time.tm_hour < 12 ? "AM" : "PM", 2); break;
+            case 'x':
+                append_clock(out, hours12, true);
+                out.append(m_time.tm_hour < 12 ? " AM" : " PM", 3);
+                break;
+            case 'X': append_clock(out, m_time.tm_hour, false); break;
+            case 'T': append_clock(out, m_time.tm_hour, true); break;
+            default: return false;
+            }
+            return true;
+        }
+
+    private:
+        /**
+         * @brief Appends a non-negative number padded with zeros to at least width digits.
+         * @param out The buffer to append to.
+         * @param value The number (negative values are written as they are).
+         * @param width The minimum number of digits.
+         */
+        static void append_number(format_buffer& out, int value, int width)
+        {
+            if (value < 0)
+            {
+                detail::write_integer(out, value);
+                return;
+            }
+            for (int limit = 10; width > 1 && value < limit; --width, limit *= 10)
+                out.push_back('0');
+            detail::write_integer(out, value);
+        }
+
+        /**
+         * @brief Appends a time of day as HH:MM or HH:MM:SS.
+         * @param out The buffer to append to.
+         * @param hours The hours to write.
+         * @param with_seconds True to append the seconds as well.
+         */
+        void append_clock(format_buffer& out, int hours, bool with_seconds) const
+        {
+            append_number(out, hours, 2);
+            out.push_back(':');
+            append_number(out, m_time.tm_min, 2);
+            if (with_seconds)
+            {
+                out.push_back(':');
+                append_number(out, m_time.tm_sec, 2);
+            }
+        }
+
+        /**
+         * @brief Formats the given time value with leading zeros if necessary.
+         * @param time_value The time value to format.
+         * @return The formatted time string.
+         */
+        DTLOG_NODISCARD std::string format_time(int time_value) const
+        {
+            std::ostringstream oss;
+            oss << std::setw(2)
+                << std::setfill('0')
+                << time_value;
+            return oss.str();
+        }
+
+        /**
+         * @brief Gets the full name of the weekday based on the day of the week.
+         * @param wday The day of the week (0-6, Sunday-Saturday).
+         * @return The full name of the weekday.
+         */
+        DTLOG_NODISCARD static std::string_view weekdays(int wday)
+        {
+            switch (wday)
+            {
+            case 0: return "Sunday";
+            case 1: return "Monday";
+            case 2: return "Tuesday";
+            case 3: return "Wednesday";
+            case 4: return "Thursday";
+            case 5: return "Friday";
+            case 6: return "Saturday";
+            default: return "Invalid Day";
+            }
+        }
+
+        /**
+         * @brief Gets the full name of the month based on the month index.
+         * @param mon The month index (0-11, January-December).
+         * @return The full name of the month.
+         */
+        DTLOG_NODISCARD static std::string_view months(int mon)
+        {
+            switch (mon)
+            {
+            case 0: return "January";
+            case 1: return "February";
+            case 2: return "March";
+            case 3: return "April";
+            case 4: return "May";
+            case 5: return "June";
+            case 6: return "July";
+            case 7: return "August";
+            case 8: return "September";
+            case 9: return "October";
+            case 10: return "November";
+            case 11: return "December";
+            default: return "Invalid Month";
+            }
+        }
+
+    private:
+        std::tm m_time; ///< A copy of the formatted time, so it is not shared with other threads.
+    };
+
+    /**
+     * @brief The source of the time a logger writes with the date and time pattern tokens; see logger::set_clock().
+     */
+    class clock_source
+    {
+    public:
+        virtual ~clock_source() = default;
+
+        /**
+         * @brief Reads the clock.
+         * @return The current calendar time.
+         */
+        virtual std::time_t now() = 0;
+    };
+
+    /**
+     * @brief The system clock read with std::time, the clock loggers use by default.
+     */
+    class real_clock : public clock_source
+    {
+    public:
+        /**
+         * @brief Reads the system clock.
+         * @return The current calendar time.
+         */
+        std::time_t now() override
+        {
+            return std::time(nullptr);
+        }
+    };
+
+    /**
+     * @brief The system clock read at the resolution of the scheduler tick (CLOCK_REALTIME_COARSE), which is cheaper
+     * than std::time where the system provides it; elsewhere it is the same as real_clock.
+     */
+    class coarse_clock : public clock_source
+    {
+    public:
+        /**
+         * @brief Reads the coarse system clock.
+         * @return The current calendar time.
+         */
+        std::time_t now() override
+        {
+#if defined(CLOCK_REALTIME_COARSE)
+            timespec value;
+            if (clock_gettime(CLOCK_REALTIME_COARSE, &value) == 0)
+                return value.tv_sec;
+#endif // CLOCK_REALTIME_COARSE
+            return std::time(nullptr);
+        }
+    };
+
+    /**
+     * @brief A clock that only moves when it is told to, so tests can expect exact output and benchmarks leave out
+     * the cost of reading the time.
+     */
+    class manual_clock : public clock_source
+    {
+    public:
+        /**
+         * @brief Creates the clock.
+         * @param time The time the clock starts at.
+         */
+        explicit manual_clock(std::time_t time = 0) : m_time(time) {}
+
+        /**
+         * @brief Reads the clock.
+         * @return The time last set.
+         */
+        std::time_t now() override
+        {
+            return m_time.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Sets the clock.
+         * @param time The new time.
+         */
+        void set(std::time_t time)
+        {
+            m_time.store(time, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Moves the clock forward.
+         * @param seconds The number of seconds.
+         */
+        void advance(std::time_t seconds)
+        {
+            m_time.fetch_add(seconds, std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<std::time_t> m_time; ///< The current time.
+    };
+
+    /**
+     * @brief Enumeration for different log levels.
+     */
+    enum class log_level
+    {
+        none,
+        trace,
+        info,
+        debug,
+        warning,
+        error,
+        critical
+    };
+
+    /**
+     * @brief The number of log levels.
+     */
+    constexpr size_t log_level_count = 7;
+
+    /**
+     * @brief Gets the position of a log level in the per-level tables (none is 0, critical is 6).
+     * @param level The log level.
+     * @return The index of the level; values outside the enumeration map to none.
+     */
+    DTLOG_NODISCARD constexpr size_t log_level_index(log_level level)
+    {
+        return static_cast<size_t>(level) < log_level_count ? static_cast<size_t>(level) : 0;
+    }
+
+    /**
+     * @brief Gets the severity of a log level: trace < debug < info < warning < error < critical.
+     *
+     * The enumeration declares info before debug, so thresholds compare severities instead of the enumerator values.
+     * @param level The log level.
+     * @return The severity; none is 0, below every other level.
+     */
+    DTLOG_NODISCARD constexpr int log_level_severity(log_level level)
+    {
+        constexpr int severities[log_level_count] = { 0, 1, 3, 2, 4, 5, 6 };
+        return severities[log_level_index(level)];
+    }
+
+    /**
+     * @brief Gets the name of a log level without allocating.
+     * @param level The log level enum.
+     * @return The name of the log level, pointing into a static table.
+     */
+    DTLOG_NODISCARD constexpr std::string_view log_level_name(log_level level)
+    {
+        constexpr std::string_view names[log_level_count] = { "none", "trace", "info", "debug", "warning", "error", "critical" };
+        return names[log_level_index(level)];
+    }
+
+    /**
+     * @brief Gets the ANSI escape sequence used to color a log level on terminals.
+     *
+     * Used by the console colors and the %c pattern token everywhere but on Windows, where the console colors are set
+     * with SetConsoleTextAttribute and %c writes the plain label.
+     * @param level The log level enum.
+     * @return The escape sequence; none and trace reset the color.
+     */
+    DTLOG_NODISCARD constexpr std::string_view log_level_ansi_color(log_level level)
+    {
+        constexpr std::string_view colors[log_level_count] = { "\x1b[0m", "\x1b[0m", "\x1b[32m", "\x1b[34m", "\x1b[33m", "\x1b[31m", "\x1b[91m" };
+        return colors[log_level_index(level)];
+    }
+
+    /**
+     * @brief Converts a log level enum to its corresponding string representation.
+     * @param level The log level enum.
+     * @return The string representation of the log level.
+     */
+    DTLOG_NODISCARD inline std::string log_level_to_string(log_level level)
+    {
+        return std::string(log_level_name(level));
+    }
+
+    /**
+     * @brief A summary of measured durations.
+     */
+    struct latency_summary
+    {
+        std::uint64_t count = 0;    ///< The number of measurements.
+        std::uint64_t total_ns = 0; ///< The sum of the durations in nanoseconds.
+        std::uint64_t max_ns = 0;   ///< The longest duration in nanoseconds.
+
+        /**
+         * @brief Gets the mean duration.
+         * @return The mean in nanoseconds, or 0 without measurements.
+         */
+        DTLOG_NODISCARD double mean_ns() const
+        {
+            return count ? static_cast<double>(total_ns) / static_cast<double>(count) : 0.0;
+        }
+    };
+
+    /**
+     * @brief A snapshot of the counters of a logger, taken by logger::stats().
+     */
+    struct logger_stats
+    {
+        std::uint64_t records[log_level_count] = {}; ///< The records written per level, indexed by log_level_index(); log_to_file() counts as none.
+        std::uint64_t bytes_written = 0;             ///< The characters of the records written; color changes are not counted.
+        std::uint64_t write_calls = 0;               ///< The std::fwrite calls.
+        std::uint64_t flushes = 0;                   ///< The std::fflush calls.
+        std::uint64_t truncated = 0;                 ///< The records cut short by allocation_policy::truncate.
+        std::uint64_t drops = 0;                     ///< The records that could not be written, or only in part.
+        std::uint64_t queue_high_water_mark = 0;     ///< Always 0: records are written by the logging thread and never queued.
+        latency_summary write_latency;               ///< The duration of the std::fwrite calls of records, if logger::set_latency_timing() is on.
+        latency_summary flush_latency;               ///< The duration of the std::fflush calls, if logger::set_latency_timing() is on.
+
+        /**
+         * @brief Gets the number of records written at every level.
+         * @return The total.
+         */
+        DTLOG_NODISCARD std::uint64_t total_records() const
+        {
+            std::uint64_t total = 0;
+            for (std::uint64_t count : records)
+                total += count;
+            return total;
+        }
+    };
+
+    namespace detail
+    {
+        /**
+         * @brief The two buffers a log record is built in: the formatted message and the record around it.
+         *
+         * Records are built in buffers kept per thread, so after warm-up logging does not allocate. The buffers take the
+         * record buffer resource (see set_record_buffer_resource()) current when the thread first logs and are reused by
+         * every logger. A record built while another one is in progress on the same thread (for example from an
+         * operator<< that logs) uses buffers local to the call, allocated from the resource of the logger.
+         * Under allocation_policy::truncate every buffer is fixed.
+         */
+        class record_buffers
+        {
+        public:
+            /**
+             * @brief Acquires the buffers for one record.
+             * @param resource The memory resource of the logger.
+             */
+            explicit record_buffers(memory_resource* resource)
+                : m_shared(nullptr), m_local_message(resource), m_local_record(resource)
+            {
+                const bool fixed = get_allocation_policy() == allocation_policy::truncate;
+                shared_buffers& shared = thread_instance();
+                if (!shared.busy)
+                {
+                    shared.busy = true;
+                    shared.message.clear();
+                    shared.record.clear();
+                    shared.message.set_fixed(fixed);
+                    shared.record.set_fixed(fixed);
+                    m_shared = &shared;
+                    return;
+                }
+                m_local_message.set_fixed(fixed);
+                m_local_record.set_fixed(fixed);
+            }
+
+            record_buffers(const record_buffers&) = delete;
+            record_buffers& operator=(const record_buffers&) = delete;
 
             /**
-             * @brief Destructor.
+             * @brief Grows the per-thread buffers of the calling thread and touches their pages.
+             * @param capacity The capacity of each buffer.
              */
-            virtual ~argument() override {}
+            static void preallocate_thread(size_t capacity)
+            {
+                shared_buffers& shared = thread_instance();
+                if (shared.busy)
+                    return;
+                for (format_buffer* buffer : { &shared.message, &shared.record })
+                {
+                    buffer->set_fixed(false);
+                    buffer->clear();
+                    std::memset(buffer->prepare(capacity), 0, capacity);
+                }
+            }
+
+            /**
+             * @brief Releases the per-thread buffers.
+             */
+            ~record_buffers()
+            {
+                if (m_shared)
+                    m_shared->busy = false;
+            }
+
+            /**
+             * @brief Gets the buffer for the formatted message.
+             * @return The message buffer.
+             */
+            DTLOG_NODISCARD format_buffer& message()
+            {
+                return m_shared ? m_shared->message : m_local_message;
+            }
+
+            /**
+             * @brief Gets the buffer for the complete record.
+             * @return The record buffer.
+             */
+            DTLOG_NODISCARD format_buffer& record()
+            {
+                return m_shared ? m_shared->record : m_local_record;
+            }
+
+            /**
+             * @brief Checks whether the message or the record lost characters under allocation_policy::truncate.
+             * @return True if either buffer was truncated.
+             */
+            DTLOG_NODISCARD bool truncated()
+            {
+                return message().truncated() || record().truncated();
+            }
+
+        private:
+            /**
+             * @brief The buffers kept per thread.
+             */
+            struct shared_buffers
+            {
+                shared_buffers() : message(get_record_buffer_resource()), record(get_record_buffer_resource()) {}
+
+                format_buffer message; ///< The formatted message.
+                format_buffer record;  ///< The complete record.
+                bool busy = false;     ///< Whether a record is being built in these buffers.
+            };
+
+            /**
+             * @brief Gets the buffers of the calling thread.
+             * @return The per-thread buffers.
+             */
+            static shared_buffers& thread_instance()
+            {
+                thread_local shared_buffers buffers;
+                return buffers;
+            }
+
+            shared_buffers* m_shared;      ///< The per-thread buffers in use, or nullptr.
+            format_buffer m_local_message; ///< The message buffer used when the per-thread buffers are not.
+            format_buffer m_local_record;  ///< The record buffer used when the per-thread buffers are not.
+        };
+
+        /**
+         * @brief A run of consecutive records of a logger::batch with the same level.
+         */
+        struct batch_run
+        {
+            size_t begin;    ///< The offset of the first character of the run.
+            log_level level; ///< The level of the records.
+        };
+
+        /**
+         * @brief The buffers the records of a logger::batch are collected in.
+         *
+         * Like record_buffers, a batch takes buffers kept per thread, so a batch does not allocate once they have grown to
+         * the size of the batches (see preallocate_thread()). A batch started while another one is alive on the same
+         * thread uses buffers of its own, allocated from the resource of the logger. Reserving a capacity also reserves
+         * one run per run_stride characters. Under allocation_policy::truncate neither buffer grows past the capacity it
+         * has when the batch starts.
+         */
+        class batch_buffer
+        {
+        public:
+            static constexpr size_t run_stride = 32; ///< The number of record characters one reserved run is counted for.
+
+            /**
+             * @brief Acquires the buffers for one batch.
+             * @param resource The memory resource of the logger.
+             * @param capacity The capacity to reserve before the records buffer is fixed. Growing the buffers allocates.
+             */
+            batch_buffer(memory_resource* resource, size_t capacity)
+                : m_shared(nullptr), m_local_records(resource), m_local_runs(resource)
+            {
+                shared_buffers& shared = thread_instance();
+                if (!shared.busy)
+                {
+                    shared.busy = true;
+                    shared.records.clear();
+                    shared.runs.clear();
+                    m_shared = &shared;
+                }
+                format_buffer& buffer = records();
+                buffer.set_fixed(false);
+                buffer.reserve(capacity);
+                buffer.set_fixed(get_allocation_policy() == allocation_policy::truncate);
+                runs().reserve(capacity / run_stride);
+            }
+
+            batch_buffer(const batch_buffer&) = delete;
+            batch_buffer& operator=(const batch_buffer&) = delete;
+
+            /**
+             * @brief Grows the per-thread buffers of the calling thread and touches the pages of the records buffer.
+             * @param capacity The capacity of the records buffer.
+             */
+            static void preallocate_thread(size_t capacity)
+            {
+                shared_buffers& shared = thread_instance();
+                if (shared.busy || capacity == 0)
+                    return;
+                shared.records.set_fixed(false);
+                shared.records.clear();
+                std::memset(shared.records.prepare(capacity), 0, capacity);
+                shared.runs.reserve(capacity / run_stride);
+            }
+
+            /**
+             * @brief Releases the per-thread buffers.
+             */
+            ~batch_buffer()
+            {
+                if (m_shared)
+                    m_shared->busy = false;
+            }
+
+            /**
+             * @brief Gets the buffer for the formatted records.
+             * @return The records buffer.
+             */
+            DTLOG_NODISCARD format_buffer& records()
+            {
+                return m_shared ? m_shared->records : m_local_records;
+            }
+
+            /**
+             * @brief Gets the runs of records with the same level.
+             * @return The runs.
+             */
+            DTLOG_NODISCARD helper_vector<batch_run, 16>& runs()
+            {
+                return m_shared ? m_shared->runs : m_local_runs;
+            }
+
+        private:
+            /**
+             * @brief The buffers kept per thread.
+             */
+            struct shared_buffers
+            {
+                shared_buffers() : records(get_record_buffer_resource()), runs(get_record_buffer_resource()) {}
+
+                format_buffer records;              ///< The formatted records.
+                helper_vector<batch_run, 16> runs;  ///< The runs of records with the same level.
+                bool busy = false;                  ///< Whether a batch is using these buffers.
+            };
+
+            /**
+             * @brief Gets the buffers of the calling thread.
+             * @return The per-thread buffers.
+             */
+            static shared_buffers& thread_instance()
+            {
+                thread_local shared_buffers buffers;
+                return buffers;
+            }
+
+            shared_buffers* m_shared;                  ///< The per-thread buffers in use, or nullptr.
+            format_buffer m_local_records;             ///< The records buffer used when the per-thread buffers are not.
+            helper_vector<batch_run, 16> m_local_runs; ///< The runs used when the per-thread buffers are not.
+        };
+
+        /**
+         * @brief Turns a logging expression into void, so DTLOG_STREAM can be the operand of a conditional operator.
+         */
+        struct stream_voidify
+        {
+            /**
+             * @brief Binds looser than operator<<, so it applies after the whole chain.
+             */
+            template <class _Ty>
+            void operator&(const _Ty&) const {}
+        };
+
+        /**
+         * @brief Holds the lock of a stdio stream, so writes from other threads cannot come in between.
+         *
+         * The lock is recursive: the stdio calls made while it is held take it again without blocking.
+         */
+        class stream_lock
+        {
+        public:
+            /**
+             * @brief Locks the stream.
+             * @param stream The stream to lock.
+             */
+            explicit stream_lock(FILE* stream) : m_stream(stream)
+            {
+#ifdef _WIN32
+                _lock_file(m_stream);
+#else // _WIN32
+                flockfile(m_stream);
+#endif // _WIN32
+            }
+
+            stream_lock(const stream_lock&) = delete;
+            stream_lock& operator=(const stream_lock&) = delete;
+
+            /**
+             * @brief Unlocks the stream.
+             */
+            ~stream_lock()
+            {
+#ifdef _WIN32
+                _unlock_file(m_stream);
+#else // _WIN32
+                funlockfile(m_stream);
+#endif // _WIN32
+            }
+
+        private:
+            FILE* m_stream; ///< The locked stream.
+        };
+
+        /**
+         * @brief A counter updated with relaxed atomic operations. Copies take the current value, so the owner
+         * stays copyable.
+         */
+        class relaxed_counter
+        {
+        public:
+            relaxed_counter() = default;
+            relaxed_counter(const relaxed_counter& other) : m_value(other.load()) {}
+
+            relaxed_counter& operator=(const relaxed_counter& other)
+            {
+                m_value.store(other.load(), std::memory_order_relaxed);
+                return *this;
+            }
+
+            /**
+             * @brief Adds to the counter.
+             * @param count The amount to add.
+             */
+            void add(std::uint64_t count)
+            {
+                m_value.fetch_add(count, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Raises the counter to a value if it is lower.
+             * @param value The value.
+             */
+            void raise(std::uint64_t value)
+            {
+                std::uint64_t current = m_value.load(std::memory_order_relaxed);
+                while (current < value && !m_value.compare_exchange_weak(current, value, std::memory_order_relaxed))
+                    ;
+            }
+
+            /**
+             * @brief Reads the counter.
+             * @return The value.
+             */
+            DTLOG_NODISCARD std::uint64_t load() const
+            {
+                return m_value.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Sets the counter.
+             * @param value The new value.
+             */
+            void store(std::uint64_t value)
+            {
+                m_value.store(value, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Replaces the value if it is still the expected one.
+             * @param expected The expected value; set to the current value on failure.
+             * @param desired The new value.
+             * @return True if the value was replaced.
+             */
+            bool compare_exchange(std::uint64_t& expected, std::uint64_t desired)
+            {
+                return m_value.compare_exchange_strong(expected, desired, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Sets the counter to 0.
+             */
+            void reset()
+            {
+                m_value.store(0, std::memory_order_relaxed);
+            }
+
+        private:
+            std::atomic<std::uint64_t> m_value{ 0 }; ///< The value.
+        };
+
+        /**
+         * @brief Accumulates the durations summarized by latency_summary.
+         */
+        struct latency_counter
+        {
+            relaxed_counter count;    ///< The number of measurements.
+            relaxed_counter total_ns; ///< The sum of the durations in nanoseconds.
+            relaxed_counter max_ns;   ///< The longest duration in nanoseconds.
+
+            /**
+             * @brief Adds a measurement.
+             * @param duration The duration.
+             */
+            void record(std::chrono::steady_clock::duration duration)
+            {
+                const std::uint64_t ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+                count.add(1);
+                total_ns.add(ns);
+                max_ns.raise(ns);
+            }
+
+            /**
+             * @brief Reads the measurements.
+             * @return The summary.
+             */
+            DTLOG_NODISCARD latency_summary snapshot() const
+            {
+                return latency_summary{ count.load(), total_ns.load(), max_ns.load() };
+            }
+
+            /**
+             * @brief Forgets the measurements.
+             */
+            void reset()
+            {
+                count.reset();
+                total_ns.reset();
+                max_ns.reset();
+            }
+        };
+
+        /**
+         * @brief Gets a small number that stays the same for the calling thread, assigned to threads in turn.
+         * @return The index of the thread.
+         */
+        inline size_t thread_shard_index()
+        {
+            static std::atomic<size_t> next_index{ 0 };
+            thread_local const size_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+            return index;
+        }
+
+        /**
+         * @brief The counters behind logger::stats().
+         *
+         * The counters are split into cache-line aligned shards and a thread always updates the shard of its
+         * thread_shard_index(), so threads logging through one logger do not contend for one cache line. snapshot()
+         * adds the shards up; a snapshot taken while others log is consistent per counter but not across counters.
+         * The write and flush latencies are only measured when timing is on (see logger::set_latency_timing()).
+         */
+        struct logger_counters
+        {
+            static constexpr size_t shard_count = 16; ///< The number of shards (a power of two).
+
+            /**
+             * @brief The counters updated by one group of threads.
+             */
+            struct alignas(64) shard
+            {
+                relaxed_counter records[log_level_count]; ///< The records written per level.
+                relaxed_counter bytes_written;            ///< The characters written.
+                relaxed_counter write_calls;              ///< The std::fwrite calls.
+                relaxed_counter flushes;                  ///< The std::fflush calls.
+                relaxed_counter truncated;                ///< The records cut short by allocation_policy::truncate.
+                relaxed_counter drops;                    ///< The records not written or written in part.
+                latency_counter write_latency;            ///< The duration of the std::fwrite calls.
+                latency_counter flush_latency;            ///< The duration of the std::fflush calls.
+            };
+
+            shard shards[shard_count]; ///< The shards.
+            relaxed_counter timing;    ///< 1 if the write and flush latencies are measured.
+
+            /**
+             * @brief Gets the shard of the calling thread.
+             * @return The shard.
+             */
+            shard& local()
+            {
+                return shards[thread_shard_index() & (shard_count - 1)];
+            }
+
+            /**
+             * @brief Writes characters to a stream and counts the call.
+             * @param stream The stream.
+             * @param data The characters.
+             * @param size The number of characters.
+             * @return True if every character was written.
+             */
+            bool write(FILE* stream, const char* data, size_t size)
+            {
+                DTLOG_STAGE_SCOPE(write);
+                shard& counters = local();
+                size_t written = 0;
+                if (timing.load() != 0)
+                {
+                    const auto start = std::chrono::steady_clock::now();
+                    written = std::fwrite(data, sizeof(char), size, stream);
+                    counters.write_latency.record(std::chrono::steady_clock::now() - start);
+                }
+                else
+                {
+                    written = std::fwrite(data, sizeof(char), size, stream);
+                }
+                counters.write_calls.add(1);
+                counters.bytes_written.add(written);
+                return written == size;
+            }
+
+            /**
+             * @brief Flushes a stream and counts the call.
+             * @param stream The stream.
+             * @return True on success.
+             */
+            bool flush(FILE* stream)
+            {
+                DTLOG_STAGE_SCOPE(flush);
+                shard& counters = local();
+                bool flushed = false;
+                if (timing.load() != 0)
+                {
+                    const auto start = std::chrono::steady_clock::now();
+                    flushed = std::fflush(stream) == 0;
+                    counters.flush_latency.record(std::chrono::steady_clock::now() - start);
+                }
+                else
+                {
+                    flushed = std::fflush(stream) == 0;
+                }
+                counters.flushes.add(1);
+                return flushed;
+            }
+
+            /**
+             * @brief Counts a record that was handed to the stream.
+             * @param level The level of the record.
+             * @param written True if the record was written completely.
+             * @param cut True if the record was truncated before it was written.
+             */
+            void count_record(log_level level, bool written, bool cut)
+            {
+                shard& counters = local();
+                if (written)
+                    counters.records[log_level_index(level)].add(1);
+                else
+                    counters.drops.add(1);
+                if (cut)
+                    counters.truncated.add(1);
+            }
+
+            /**
+             * @brief Counts the records of a batch that was handed to the stream.
+             * @param levels The number of records per level, indexed by log_level_index().
+             * @param count The number of records.
+             * @param written True if the batch was written completely.
+             * @param cut The number of records that were truncated before they were written.
+             */
+            void count_records(const size_t* levels, size_t count, bool written, size_t cut)
+            {
+                shard& counters = local();
+                if (written)
+                {
+                    for (size_t i = 0; i < log_level_count; ++i)
+                        if (levels[i] != 0)
+                            counters.records[i].add(levels[i]);
+                }
+                else
+                {
+                    counters.drops.add(count);
+                }
+                if (cut != 0)
+                    counters.truncated.add(cut);
+            }
+
+            /**
+             * @brief Adds up the shards.
+             * @return The snapshot.
+             */
+            DTLOG_NODISCARD logger_stats snapshot() const
+            {
+                logger_stats out;
+                for (const shard& counters : shards)
+                {
+                    for (size_t i = 0; i < log_level_count; ++i)
+                        out.records[i] += counters.records[i].load();
+                    out.bytes_written += counters.bytes_written.load();
+                    out.write_calls += counters.write_calls.load();
+                    out.flushes += counters.flushes.load();
+                    out.truncated += counters.truncated.load();
+                    out.drops += counters.drops.load();
+                    merge(out.write_latency, counters.write_latency.snapshot());
+                    merge(out.flush_latency, counters.flush_latency.snapshot());
+                }
+                return out;
+            }
+
+            /**
+             * @brief Sets every counter to 0. Timing stays as it is.
+             */
+            void reset()
+            {
+                for (shard& counters : shards)
+                {
+                    for (relaxed_counter& counter : counters.records)
+                        counter.reset();
+                    counters.bytes_written.reset();
+                    counters.write_calls.reset();
+                    counters.flushes.reset();
+                    counters.truncated.reset();
+                    counters.drops.reset();
+                    counters.write_latency.reset();
+                    counters.flush_latency.reset();
+                }
+            }
 
+        private:
             /**
-             * @brief Formats the argument into the output stream.
-             * @param oss The output stream.
+             * @brief Adds the measurements of one shard to a summary.
+             * @param total The summary.
+             * @param part The measurements of the shard.
              */
-            virtual void format(std::ostringstream& oss) override
+            static void merge(latency_summary& total, const latency_summary& part)
             {
-                oss << m_argument;
+                total.count += part.count;
+                total.total_ns += part.total_ns;
+                total.max_ns = part.max_ns > total.max_ns ? part.max_ns : total.max_ns;
             }
-
-        private:
-            _Ty m_argument; ///< The value of the argument.
         };
 
         /**
-         * @brief A helper vector for managing an array of argument_base pointers.
+         * @brief The state of the periodic self-report of a logger. Times are steady_clock nanoseconds.
          */
-        class argument_array : public helper_vector<argument_base*>
+        struct self_report_state
         {
-        public:
-            argument_array() {}
-            ~argument_array()
+            relaxed_counter interval_ns;  ///< The time between two reports, or 0 if reports are off.
+            relaxed_counter due_ns;       ///< The time the next report is due.
+            relaxed_counter last_ns;      ///< The time of the previous report.
+            relaxed_counter last_records; ///< The records written at the previous report.
+            relaxed_counter last_bytes;   ///< The bytes written at the previous report.
+            relaxed_counter last_drops;   ///< The records dropped at the previous report.
+
+            /**
+             * @brief Reads the clock the reports are scheduled with.
+             * @return The current time in nanoseconds.
+             */
+            static std::uint64_t now_ns()
             {
-                for (auto item : *this)
-                {
-                    delete item;
-                }
+                return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
             }
         };
 
         /**
-         * @brief Formats a single item into the output stream.
-         * @param oss The output stream.
-         * @param item The item to format.
-         * @param arguments The array of arguments.
+         * @brief Writes a duration in the largest unit that keeps it at least 1, with three decimals: "850 ns",
+         * "12.345 us", "1.500 ms", "2.250 s".
+         * @param out The buffer to write to.
+         * @param duration The duration.
          */
-        static void format_item(std::ostringstream& oss, const std::string& item, const argument_array& arguments)
+        inline void write_duration(format_buffer& out, std::chrono::nanoseconds duration)
         {
-            size_t index = 0;
-            char* endptr = nullptr;
-#if _WIN64
-            index = std::strtoull(&item[0], &endptr, 10);
-#else // !_WIN64
-            index = std::strtoul(&item[0], &endptr, 10);
-#endif // _WIN64
-
-            if (index >= arguments.size())
+            std::uint64_t ns = duration.count() > 0 ? static_cast<std::uint64_t>(duration.count()) : 0;
+            if (ns < 1000)
+            {
+                write_integer(out, ns);
+                out.append(" ns", 3);
                 return;
-            arguments[index]->format(oss);
-        }
+            }
 
-        /**
-         * @brief Transfers the arguments into the argument array.
-         * @tparam _Arg The type of the first argument.
-         * @tparam _Ty The types of the remaining arguments.
-         * @param arguments The argument array.
-         * @param first The first argument.
-         * @param rest The remaining arguments.
-         */
-        template <typename _Arg, typename... _Ty>
-        static void transfer_to_array(argument_array& arguments, _Arg&& first, _Ty&&... rest)
-        {
-            arguments.push_back(new argument<_Arg>(std::forward<_Arg>(first)));
-            transfer_to_array(arguments, std::forward<_Ty>(rest)...);
+            std::uint64_t scale = 1000;
+            const char* unit = " us";
+            if (ns >= 1000000000)
+            {
+                scale = 1000000000;
+                unit = " s";
+            }
+            else if (ns >= 1000000)
+            {
+                scale = 1000000;
+                unit = " ms";
+            }
+            const std::uint64_t milli = (ns % scale) / (scale / 1000);
+            write_integer(out, ns / scale);
+            out.push_back('.');
+            out.push_back(static_cast<char>('0' + milli / 100));
+            out.push_back(static_cast<char>('0' + milli / 10 % 10));
+            out.push_back(static_cast<char>('0' + milli % 10));
+            out.append(unit, std::strlen(unit));
         }
+    } // namespace detail
 
-        /**
-         * @brief Base case for transferring arguments into the argument array.
-         * @param arguments The argument array.
-         */
-        static void transfer_to_array(argument_array& arguments) {}
-    };
+    class trace_sink;
+
+    template <class ..._Args>
+    class scoped_timer;
 
     /**
- * @brief A utility class for formatting date and time strings.
- */
-    class date_time_formatter
+     * @brief Counts the records and bytes logged by one statement.
+     *
+     * Sites are created as function-local statics by DTLOG_LOG and the DTLOG_STREAM macros. A site adds itself to a
+     * process-wide lock-free list the first time it counts a record; after that counting is two relaxed increments.
+     * Sites must have static storage duration, since the list keeps pointing at them.
+     */
+    class call_site
     {
     public:
         /**
-         * @brief Default constructor.
-         * Initializes the formatter with the current local time.
+         * @brief Describes a statement.
+         * @param file The source file, usually __FILE__.
+         * @param line The line, usually __LINE__.
+         * @param function The enclosing function, usually __func__.
          */
-        date_time_formatter()
-        {
-            reset_time();
-        }
+        constexpr call_site(const char* file, int line, const char* function) : m_file(file), m_function(function), m_line(line) {}
 
-        /**
-         * @brief Constructor that initializes the formatter with the specified time.
-         * @param timeptr Pointer to a std::tm structure representing the time.
-         */
-        explicit date_time_formatter(const std::tm* timeptr) : m_timeptr(timeptr) {}
+        call_site(const call_site&) = delete;
+        call_site& operator=(const call_site&) = delete;
 
-#pragma warning(push)
-#pragma warning(disable : 4996)
         /**
-         * @brief Resets the time to the current local time.
+         * @brief Counts a record written by this statement.
+         * @param bytes The size of the record.
          */
-        void reset_time()
+        void count(size_t bytes)
         {
-            std::time_t t = std::time(nullptr);
-            m_timeptr = std::localtime(&t);
+            if (!m_registered.load(std::memory_order_acquire))
+                add_to_list();
+            m_records.fetch_add(1, std::memory_order_relaxed);
+            m_bytes.fetch_add(bytes, std::memory_order_relaxed);
         }
-#pragma warning(pop)
 
         /**
-         * @brief Gets the full name of the weekday.
-         * @return The full name of the weekday.
+         * @brief Gets the source file of the statement.
+         * @return The file name.
          */
-        DTLOG_NODISCARD std::string full_weekday_name() const
+        DTLOG_NODISCARD const char* file() const
         {
-            return weekdays(m_timeptr->tm_wday);
+            return m_file;
         }
 
         /**
-         * @brief Gets the full name of the month.
-         * @return The full name of the month.
+         * @brief Gets the line of the statement.
+         * @return The line.
          */
-        DTLOG_NODISCARD std::string full_month_name() const
+        DTLOG_NODISCARD int line() const
         {
-            return months(m_timeptr->tm_mon);
+            return m_line;
         }
 
         /**
-         * @brief Gets the last two digits of the year.
-         * @return The last two digits of the year.
+         * @brief Gets the function the statement is in.
+         * @return The function name.
          */
-        DTLOG_NODISCARD std::string year_2_digits() const
+        DTLOG_NODISCARD const char* function() const
         {
-            return std::to_string(m_timeptr->tm_year % 100);
+            return m_function;
         }
 
         /**
-         * @brief Gets the full four digits of the year.
-         * @return The full four digits of the year.
+         * @brief Gets the number of records counted.
+         * @return The count.
          */
-        DTLOG_NODISCARD std::string year_4_digits() const
+        DTLOG_NODISCARD std::uint64_t records() const
         {
-            return std::to_string(m_timeptr->tm_year + 1900);
+            return m_records.load(std::memory_order_relaxed);
         }
 
         /**
-         * @brief Gets the date and time representation in a specific format.
-         * @return The formatted date and time string.
+         * @brief Gets the number of bytes counted.
+         * @return The count.
          */
-        DTLOG_NODISCARD std::string date_time_representation() const
+        DTLOG_NODISCARD std::uint64_t bytes() const
         {
-            std::ostringstream oss;
-            oss << weekdays(m_timeptr->tm_wday)
-                << " "
-                << months(m_timeptr->tm_mon)
-                << " "
-                << m_timeptr->tm_mday
-                << " "
-                << m_timeptr->tm_year + 1900
-                << " "
-                << format_time(m_timeptr->tm_hour)
-                << ":"
-                << format_time(m_timeptr->tm_min)
-                << ":"
-                << format_time(m_timeptr->tm_sec);
-            return oss.str();
+            return m_bytes.load(std::memory_order_relaxed);
         }
 
         /**
-         * @brief Gets the short date representation in MM/DD/YY format.
-         * @return The short date string.
+         * @brief Sets the counters to 0; the site stays in the list.
          */
-        DTLOG_NODISCARD std::string short_MMDDYY_date() const
+        void reset()
         {
-            std::ostringstream oss;
-            oss << format_time(m_timeptr->tm_mon + 1)
-                << "/"
-                << format_time(m_timeptr->tm_mday)
-                << "/"
-                << format_time((m_timeptr->tm_year % 100));
-            return oss.str();
+            m_records.store(0, std::memory_order_relaxed);
+            m_bytes.store(0, std::memory_order_relaxed);
         }
 
         /**
-         * @brief Gets the month as a numeric string.
-         * @return The numeric representation of the month.
+         * @brief Gets the first site of the list; the others follow through next().
+         * @return The most recently added site, or nullptr if none has counted a record yet.
          */
-        DTLOG_NODISCARD std::string month() const
+        DTLOG_NODISCARD static const call_site* first()
         {
-            return std::to_string(m_timeptr->tm_mon + 1);
+            return list_head().load(std::memory_order_acquire);
         }
 
         /**
-         * @brief Gets the day of the month as a string.
-         * @return The day of the month.
+         * @brief Gets the site added before this one.
+         * @return The next site, or nullptr at the end of the list.
          */
-        DTLOG_NODISCARD std::string day_of_month() const
+        DTLOG_NODISCARD const call_site* next() const
         {
-            return std::to_string(m_timeptr->tm_mday);
+            return m_next;
         }
 
+    private:
         /**
-         * @brief Gets the hours in 24-hour format.
-         * @return The hours in 24-hour format.
+         * @brief Gets the head of the list of sites.
+         * @return The head.
          */
-        DTLOG_NODISCARD std::string hours_24_format() const
+        static std::atomic<call_site*>& list_head()
         {
-            return std::to_string(m_timeptr->tm_hour);
+            static std::atomic<call_site*> head{ nullptr };
+            return head;
         }
 
         /**
-         * @brief Gets the hours in 12-hour format.
-         * @return The hours in 12-hour format.
+         * @brief Pushes this site onto the list once.
          */
-        DTLOG_NODISCARD std::string hours_12_format() const
+        void add_to_list()
         {
-            int hours12 = m_timeptr->tm_hour % 12;
-            if (hours12 == 0)
-                hours12 = 12;
-            return std::to_string(hours12);
+            bool expected = false;
+            if (!m_claimed.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+                return;
+            std::atomic<call_site*>& head = list_head();
+            call_site* current = head.load(std::memory_order_relaxed);
+            do
+                m_next = current;
+            while (!head.compare_exchange_weak(current, this, std::memory_order_release, std::memory_order_relaxed));
+            m_registered.store(true, std::memory_order_release);
         }
 
-        /**
-         * @brief Gets the minutes as a string.
-         * @return The minutes.
-         */
-        DTLOG_NODISCARD std::string minutes() const
-        {
-            return std::to_string(m_timeptr->tm_min);
-        }
+        const char* m_file;                       ///< The source file.
+        const char* m_function;                   ///< The enclosing function.
+        int m_line;                               ///< The line.
+        call_site* m_next = nullptr;              ///< The site added before this one.
+        std::atomic<bool> m_claimed{ false };     ///< Set by the thread that adds the site to the list.
+        std::atomic<bool> m_registered{ false };  ///< Set once the site is in the list.
+        std::atomic<std::uint64_t> m_records{ 0 }; ///< The records counted.
+        std::atomic<std::uint64_t> m_bytes{ 0 };   ///< The bytes counted.
+    };
 
-        /**
-         * @brief Gets the seconds as a
-         * string.
-         * @return The seconds.
-         */
-        DTLOG_NODISCARD std::string seconds() const
-        {
-            return std::to_string(m_timeptr->tm_sec);
-        }
+    /**
+     * @brief The order of top_call_sites().
+     */
+    enum class call_site_order
+    {
+        bytes,  ///< The sites with the most bytes first.
+        records ///< The sites with the most records first.
+    };
 
-        /**
-         * @brief Gets the AM/PM designation.
-         * @return "AM" if the time is before noon, "PM" otherwise.
-         */
-        DTLOG_NODISCARD std::string AM_PM() const
-        {
-            return (m_timeptr->tm_hour < 12) ? "AM" : "PM";
-        }
+    /**
+     * @brief A snapshot of the counters of a call site.
+     */
+    struct call_site_stats
+    {
+        const call_site* site = nullptr; ///< The site.
+        std::uint64_t records = 0;       ///< The records counted.
+        std::uint64_t bytes = 0;         ///< The bytes counted.
+    };
 
-        /**
-         * @brief Gets the time in 12-hour clock format.
-         * @return The time in 12-hour format along with AM/PM designation.
-         */
-        DTLOG_NODISCARD std::string clock_12_hour() const
+    /**
+     * @brief Finds the noisiest statements.
+     * @param out The array the sites are written to, noisiest first.
+     * @param capacity The number of elements of out.
+     * @param order Whether bytes or records are compared.
+     * @return The number of sites written, at most capacity.
+     */
+    inline size_t top_call_sites(call_site_stats* out, size_t capacity, call_site_order order = call_site_order::bytes)
+    {
+        size_t count = 0;
+        if (capacity == 0)
+            return 0;
+        for (const call_site* site = call_site::first(); site; site = site->next())
         {
-            std::ostringstream oss;
-            oss << format_time((m_timeptr->tm_hour % 12 == 0) ? 12 : m_timeptr->tm_hour % 12)
-                << ":"
-                << format_time(m_timeptr->tm_min)
-                << ":"
-                << format_time(m_timeptr->tm_sec) << " "
-                << ((m_timeptr->tm_hour < 12) ? "AM" : "PM");
-            return oss.str();
+            const call_site_stats entry{ site, site->records(), site->bytes() };
+            const std::uint64_t key = order == call_site_order::bytes ? entry.bytes : entry.records;
+            size_t position = count;
+            while (position > 0 && (order == call_site_order::bytes ? out[position - 1].bytes : out[position - 1].records) < key)
+                --position;
+            if (position == capacity)
+                continue;
+            const size_t last = count < capacity ? count : capacity - 1;
+            for (size_t i = last; i > position; --i)
+                out[i] = out[i - 1];
+            out[position] = entry;
+            if (count < capacity)
+                ++count;
         }
+        return count;
+    }
 
-        /**
-         * @brief Gets the time in HH:MM format (24-hour clock).
-         * @return The time in HH:MM format.
-         */
-        DTLOG_NODISCARD std::string HHMM_time_24_hour() const
-        {
-            std::ostringstream oss;
-            oss << format_time(m_timeptr->tm_hour)
-                << ":"
-                << format_time(m_timeptr->tm_min);
-            return oss.str();
-        }
+    /**
+     * @brief Writes a table of the noisiest statements.
+     * @param stream The stream to write to.
+     * @param count The number of sites.
+     * @param order Whether the sites are ranked by bytes or records.
+     */
+    inline void dump_call_sites(FILE* stream = stderr, size_t count = 10, call_site_order order = call_site_order::bytes)
+    {
+        if (!stream)
+            return;
+        helper_vector<call_site_stats, 16> top(get_default_resource());
+        top.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+            top.push_back(call_site_stats{});
+        const size_t found = count ? top_call_sites(&top[0], count, order) : 0;
 
-        /**
-         * @brief Gets the time in ISO 8601 format (HH:MM:SS).
-         * @return The time in ISO 8601 format.
-         */
-        DTLOG_NODISCARD std::string ISO8601_time_format() const
-        {
-            std::ostringstream oss;
-            oss << format_time(m_timeptr->tm_hour)
-                << ":"
-                << format_time(m_timeptr->tm_min)
-                << ":"
-                << format_time(m_timeptr->tm_sec);
-            return oss.str();
-        }
+        std::fprintf(stream, "%14s %16s  %s\n", "records", "bytes", "call site");
+        for (size_t i = 0; i < found; ++i)
+            std::fprintf(stream, "%14llu %16llu  %s:%d (%s)\n", static_cast<unsigned long long>(top[i].records),
+                static_cast<unsigned long long>(top[i].bytes), top[i].site->file(), top[i].site->line(), top[i].site->function());
+        std::fflush(stream);
+    }
 
-    private:
+    /**
+     * @brief Sets the counters of every call site to 0.
+     */
+    inline void reset_call_sites()
+    {
+        for (const call_site* site = call_site::first(); site; site = site->next())
+            const_cast<call_site*>(site)->reset();
+    }
+
+    /**
+     * @brief A class for logging messages with various log levels and formatting options.
+     */
+    class logger
+    {
+    public:
         /**
-         * @brief Formats the given time value with leading zeros if necessary.
-         * @param time_value The time value to format.
-         * @return The formatted time string.
+         * @brief Constructor for the logger.
+         * @param log_name The name of the logger.
+         * @param pattern The log message pattern.
+         * @param resource The memory resource for the batches and nested records of this logger, or nullptr for std::malloc.
          */
-        DTLOG_NODISCARD std::string format_time(int time_value) const
+        logger(const std::string& log_name = "dtlog", const std::string& pattern = "[%R] %N: %V", memory_resource* resource = get_default_resource())
+            : log_name(log_name), log_pattern(pattern), log_resource(resource), log_threshold(log_level::none)
         {
-            std::ostringstream oss;
-            oss << std::setw(2)
-                << std::setfill('0')
-                << time_value;
-            return oss.str();
+            for (size_t i = 0; i < log_level_count; ++i)
+                log_levels[i].label = std::string(log_level_name(static_cast<log_level>(i)));
+            render_level_fragments();
         }
 
         /**
-         * @brief Gets the full name of the weekday based on the day of the week.
-         * @param wday The day of the week (0-6, Sunday-Saturday).
-         * @return The full name of the weekday.
+         * @brief Logs a message with the specified log level.
+         * @tparam _Args Variadic template for message arguments.
+         * @param level The log level.
+         * @param message The log message.
+         * @param args Additional arguments for formatting the message.
          */
-        DTLOG_NODISCARD std::string weekdays(int wday) const
+        template <class ..._Args>
+        void log(log_level level, std::string_view message, _Args&&... args)
         {
-            switch (wday)
-            {
-            case 0: return "Sunday";
-            case 1: return "Monday";
-            case 2: return "Tuesday";
-            case 3: return "Wednesday";
-            case 4: return "Thursday";
-            case 5: return "Friday";
-            case 6: return "Saturday";
-            default: return "Invalid Day";
-            }
+            if (!should_log(level))
+                return;
+            detail::record_buffers buffers(log_resource);
+            formatter::format_to(buffers.message(), message, std::forward<_Args>(args)...);
+            pattern(level, buffers.message().view(), buffers.record());
+            write_record(stdout, level, buffers);
         }
 
         /**
-         * @brief Gets the full name of the month based on the month index.
-         * @param mon The month index (0-11, January-December).
-         * @return The full name of the month.
+         * @brief Logs a message with the specified log level and counts it for a call site. Used by DTLOG_LOG.
+         * @tparam _Args Variadic template for message arguments.
+         * @param site The statement the record is counted for.
+         * @param level The log level.
+         * @param message The log message.
+         * @param args Additional arguments for formatting the message.
          */
-        DTLOG_NODISCARD std::string months(int mon) const
+        template <class ..._Args>
+        void log_at(call_site& site, log_level level, std::string_view message, _Args&&... args)
         {
-            switch (mon)
-            {
-            case 0: return "January";
-            case 1: return "February";
-            case 2: return "March";
-            case 3: return "April";
-            case 4: return "May";
-            case 5: return "June";
-            case 6: return "July";
-            case 7: return "August";
-            case 8: return "September";
-            case 9: return "October";
-            case 10: return "November";
-            case 11: return "December";
-            default: return "Invalid Month";
-            }
+            if (!should_log(level))
+                return;
+            detail::record_buffers buffers(log_resource);
+            formatter::format_to(buffers.message(), message, std::forward<_Args>(args)...);
+            pattern(level, buffers.message().view(), buffers.record());
+            write_record(stdout, level, buffers);
+            site.count(buffers.record().size());
         }
 
-    private:
-        const std::tm* m_timeptr;
-    };
-
-    /**
-     * @brief Enumeration for different log levels.
-     */
-    enum class log_level
-    {
-        none,
-        trace,
-        info,
-        debug,
-        warning,
-        error,
-        critical
-    };
-
-    /**
-     * @brief Converts a log level enum to its corresponding string representation.
-     * @param level The log level enum.
-     * @return The string representation of the log level.
-     */
-    DTLOG_NODISCARD inline std::string log_level_to_string(log_level level)
-    {
-        switch (level)
-        {
-        case dtlog::log_level::trace:
-            return "trace";
-        case dtlog::log_level::info:
-            return "info";
-        case dtlog::log_level::debug:
-            return "debug";
-        case dtlog::log_level::warning:
-            return "warning";
-        case dtlog::log_level::error:
-            return "error";
-        case dtlog::log_level::critical:
-            return "critical";
-        case dtlog::log_level::none:
-        default:
-            return "none";
+        /**
+         * @brief Logs a message with the specified log level to stderr.
+         * @tparam _Args Variadic template for message arguments.
+         * @param level The log level.
+         * @param message The log message.
+         * @param args Additional arguments for formatting the message.
+         */
+        template <class ..._Args>
+        void log_stderr(log_level level, std::string_view message, _Args&&... args)
+        {
+            if (!should_log(level))
+                return;
+            detail::record_buffers buffers(log_resource);
+            formatter::format_to(buffers.message(), message, std::forward<_Args>(args)...);
+            pattern(level, buffers.message().view(), buffers.record());
+            write_record(stderr, level, buffers);
         }
-    }
 
-    /**
-     * @brief A class for logging messages with various log levels and formatting options.
-     */
-    class logger
-    {
-    public:
         /**
-         * @brief Constructor for the logger.
-         * @param log_name The name of the logger.
-         * @param pattern The log message pattern.
+         * @brief Logs a printf-style message with the specified log level.
+         *
+         * The format string is checked against the argument types (at compile time with C++20 or DTLOG_PRINTF) and
+         * rendered with the formatter's kernels instead of vsnprintf. A format string that does not match is logged with
+         * the error in brackets.
+         * @tparam _Args Variadic template for message arguments.
+         * @param level The log level.
+         * @param fmt The printf format string; use runtime_printf() for strings built at run time.
+         * @param args The arguments.
          */
-        logger(const std::string& log_name = "dtlog", const std::string& pattern = "[%R] %N: %V") : log_name(log_name), log_pattern(pattern) {}
+        template <class ..._Args>
+        void logf(log_level level, printf_format<std::decay_t<_Args>...> fmt, const _Args&... args)
+        {
+            if (!should_log(level))
+                return;
+            detail::record_buffers buffers(log_resource);
+            formatter::printf_to(buffers.message(), fmt, args...);
+            pattern(level, buffers.message().view(), buffers.record());
+            write_record(stdout, level, buffers);
+        }
 
         /**
-         * @brief Logs a message with the specified log level.
+         * @brief Logs a message of several lines as one record.
+         *
+         * The pattern is applied to every line of the formatted message, all with the same timestamp, and the
+         * lines are written with one write while the stream is locked, so lines of other threads cannot come in
+         * between.
          * @tparam _Args Variadic template for message arguments.
          * @param level The log level.
          * @param message The log message.
          * @param args Additional arguments for formatting the message.
          */
         template <class ..._Args>
-        void log(log_level level, const std::string& message, _Args&&... args)
+        void log_multiline(log_level level, std::string_view message, _Args&&... args)
         {
-            std::string formatted_message = formatter::format(message, std::forward<_Args>(args)...);
-            std::string log_message;
-            pattern(level, formatted_message, log_message);
-            set_stdout_color(level);
-            std::fwrite(log_message.c_str(), sizeof(char), log_message.length(), stdout);
-            std::fflush(stdout);
-            set_stdout_color(log_level::none);
+            if (!should_log(level))
+                return;
+            detail::record_buffers buffers(log_resource);
+            formatter::format_to(buffers.message(), message, std::forward<_Args>(args)...);
+            pattern_lines(level, buffers.message().view(), buffers.record());
+            write_record(stdout, level, buffers);
         }
 
         /**
-         * @brief Logs a message with the specified log level to stderr.
+         * @brief Logs a message of several lines as one record to stderr.
          * @tparam _Args Variadic template for message arguments.
          * @param level The log level.
          * @param message The log message.
          * @param args Additional arguments for formatting the message.
          */
         template <class ..._Args>
-        void log_stderr(log_level level, const std::string& message, _Args&&... args)
+        void log_multiline_stderr(log_level level, std::string_view message, _Args&&... args)
         {
-            std::string formatted_message = formatter::format(message, std::forward<_Args>(args)...);
-            std::string log_message;
-            pattern(level, formatted_message, log_message);
-            set_stderr_color(level);
-            std::fwrite(log_message.c_str(), sizeof(char), log_message.length(), stderr);
-            std::fflush(stderr);
-            set_stderr_color(log_level::none);
+            if (!should_log(level))
+                return;
+            detail::record_buffers buffers(log_resource);
+            formatter::format_to(buffers.message(), message, std::forward<_Args>(args)...);
+            pattern_lines(level, buffers.message().view(), buffers.record());
+            write_record(stderr, level, buffers);
         }
 
         /**
@@ -722,7 +4828,7 @@ namespace dtlog
          * @param args Additional arguments for formatting the message.
          */
         template <class ..._Args>
-        void log_to_file(const std::string& filename, const std::string& message, _Args&&... args)
+        void log_to_file(const std::string& filename, std::string_view message, _Args&&... args)
         {
             FILE* file = std::fopen(filename.c_str(), "a+");
             if (!file)
@@ -739,13 +4845,15 @@ namespace dtlog
          * @param args Additional arguments for formatting the message.
          */
         template <class ..._Args>
-        void log_to_file(FILE* file, const std::string& message, _Args&&... args)
+        void log_to_file(FILE* file, std::string_view message, _Args&&... args)
         {
             if (!file)
                 return; // It was not successful, but instead of assertion, we just return. We don't simply log to file.
-            std::string formatted_message = formatter::format(message, std::forward<_Args>(args)...);
-            std::fwrite(formatted_message.c_str(), sizeof(char), formatted_message.length(), file);
-            std::fflush(file);
+            detail::record_buffers buffers(log_resource);
+            formatter::format_to(buffers.message(), message, std::forward<_Args>(args)...);
+            const bool written = log_counters.write(file, buffers.message().data(), buffers.message().size());
+            log_counters.count_record(log_level::none, log_counters.flush(file) && written, buffers.message().truncated());
+            self_report_if_due(file);
         }
 
         /**
@@ -784,6 +4892,198 @@ namespace dtlog
             return log_pattern;
         }
 
+        /**
+         * @brief Formats a record with the pattern of this logger without writing it, for example for a custom sink.
+         * @param level The log level.
+         * @param message The formatted message.
+         * @param out The buffer the record is appended to.
+         */
+        void format_record(log_level level, std::string_view message, format_buffer& out)
+        {
+            pattern(level, message, out);
+        }
+
+        /**
+         * @brief Sets the lowest level that is logged. log_level::none (the default) logs every level.
+         * @param level The new threshold.
+         */
+        void set_level(log_level level)
+        {
+            log_threshold = level;
+        }
+
+        /**
+         * @brief Gets the lowest level that is logged.
+         * @return The threshold.
+         */
+        DTLOG_NODISCARD log_level get_level() const
+        {
+            return log_threshold;
+        }
+
+        /**
+         * @brief Checks whether records of a level are logged.
+         * @param level The log level.
+         * @return True if the severity of level is not below the severity of the threshold.
+         */
+        DTLOG_NODISCARD bool should_log(log_level level) const
+        {
+            return log_level_severity(level) >= log_level_severity(log_threshold);
+        }
+
+        /**
+         * @brief Takes a snapshot of the counters of this logger: records per level, bytes, write and flush calls with
+         * their latency, truncated and dropped records.
+         *
+         * Every thread that logs updates its own shard of the counters with relaxed atomic operations, so the snapshot
+         * can be taken at any time; counters read while other threads log may be a few records apart from each other.
+         * Records filtered out by set_level() are not counted. The latencies stay 0 unless set_latency_timing() is on.
+         * @return The snapshot.
+         */
+        DTLOG_NODISCARD logger_stats stats() const
+        {
+            return log_counters.snapshot();
+        }
+
+        /**
+         * @brief Turns the measurement of the std::fwrite and std::fflush latencies reported by stats() on or off.
+         *
+         * Off by default: measuring reads the steady clock around every write and flush.
+         * @param enabled True to measure the latencies.
+         */
+        void set_latency_timing(bool enabled)
+        {
+            log_counters.timing.store(enabled ? 1 : 0);
+        }
+
+        /**
+         * @brief Checks whether the write and flush latencies are measured.
+         * @return True if they are measured.
+         */
+        DTLOG_NODISCARD bool get_latency_timing() const
+        {
+            return log_counters.timing.load() != 0;
+        }
+
+        /**
+         * @brief Sets every counter of this logger to 0.
+         */
+        void reset_stats()
+        {
+            log_counters.reset();
+            const logger_stats current = log_counters.snapshot();
+            log_self_report.last_records.store(current.total_records());
+            log_self_report.last_bytes.store(current.bytes_written);
+            log_self_report.last_drops.store(current.drops);
+        }
+
+        /**
+         * @brief Sets the clock the date and time pattern tokens are read from.
+         * @param clock The clock, for example a coarse_clock or a manual_clock, or nullptr for the system clock (the
+         * default). It must outlive the logger and its copies.
+         */
+        void set_clock(clock_source* clock)
+        {
+            log_clock = clock;
+        }
+
+        /**
+         * @brief Gets the clock of this logger.
+         * @return The clock, or nullptr for the system clock.
+         */
+        DTLOG_NODISCARD clock_source* get_clock() const
+        {
+            return log_clock;
+        }
+
+        /**
+         * @brief Sets the trace sink the scoped timers of this logger write their spans to.
+         * @param sink The sink, or nullptr to stop tracing. It must outlive the timers that use it.
+         */
+        void set_trace_sink(trace_sink* sink)
+        {
+            log_trace_sink = sink;
+        }
+
+        /**
+         * @brief Gets the trace sink of this logger.
+         * @return The sink, or nullptr.
+         */
+        DTLOG_NODISCARD trace_sink* get_trace_sink() const
+        {
+            return log_trace_sink;
+        }
+
+        /**
+         * @brief Makes the logger write a summary record every interval: records/s, bytes/s and drops since the
+         * previous summary, and the queue depth (always 0, records are not queued).
+         *
+         * There is no background thread: the first record written after the interval has passed writes the summary
+         * at log_level::info to the same stream (stdout, stderr, the stream of a batch or the file of log_to_file()),
+         * from the thread that logged it, so a logger that is idle reports nothing. set_level() does not filter it.
+         * @param interval The time between two summaries; zero turns them off (the default).
+         */
+        void set_self_report_interval(std::chrono::milliseconds interval)
+        {
+            const std::uint64_t now = detail::self_report_state::now_ns();
+            const std::uint64_t interval_ns = interval.count() > 0 ? static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count()) : 0;
+            const logger_stats current = log_counters.snapshot();
+            log_self_report.last_ns.store(now);
+            log_self_report.last_records.store(current.total_records());
+            log_self_report.last_bytes.store(current.bytes_written);
+            log_self_report.last_drops.store(current.drops);
+            log_self_report.due_ns.store(now + interval_ns);
+            log_self_report.interval_ns.store(interval_ns);
+        }
+
+        /**
+         * @brief Gets the time between two summary records.
+         * @return The interval, or zero if summaries are off.
+         */
+        DTLOG_NODISCARD std::chrono::milliseconds get_self_report_interval() const
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::nanoseconds(log_self_report.interval_ns.load()));
+        }
+
+        /**
+         * @brief Sets the label written for a log level by the %L, %l, %p and %c pattern tokens.
+         * @param level The log level.
+         * @param label The new label, for example "WARN".
+         */
+        void set_level_label(log_level level, std::string_view label)
+        {
+            log_levels[log_level_index(level)].label = std::string(label);
+            render_level_fragments();
+        }
+
+        /**
+         * @brief Gets the label written for a log level.
+         * @param level The log level.
+         * @return The label of the level.
+         */
+        DTLOG_NODISCARD std::string get_level_label(log_level level) const
+        {
+            return log_levels[log_level_index(level)].label;
+        }
+
+        /**
+         * @brief Sets the memory resource used for the batches and nested records of this logger.
+         * @param resource The memory resource, or nullptr for std::malloc. It must outlive the logger.
+         */
+        void set_memory_resource(memory_resource* resource)
+        {
+            log_resource = resource;
+        }
+
+        /**
+         * @brief Gets the memory resource used for the batches and nested records of this logger.
+         * @return The memory resource, or nullptr for std::malloc.
+         */
+        DTLOG_NODISCARD memory_resource* get_memory_resource() const
+        {
+            return log_resource;
+        }
+
         /**
         * @brief Logs a trace message to the given file stream.
         * @tparam _Args Variadic template for message arguments.
@@ -792,7 +5092,7 @@ namespace dtlog
         * @param args Additional arguments for formatting the message.
         */
         template <class ..._Args>
-        void trace(const std::string& message, _Args&&... args)
+        void trace(std::string_view message, _Args&&... args)
         {
             return this->log(log_level::trace, message, std::forward<_Args>(args)...);
         }
@@ -805,7 +5105,7 @@ namespace dtlog
         * @param args Additional arguments for formatting the message.
         */
         template <class ..._Args>
-        void info(const std::string& message, _Args&&... args)
+        void info(std::string_view message, _Args&&... args)
         {
             return this->log(log_level::info, message, std::forward<_Args>(args)...);
         }
@@ -818,7 +5118,7 @@ namespace dtlog
         * @param args Additional arguments for formatting the message.
         */
         template <class ..._Args>
-        void debug(const std::string& message, _Args&&... args)
+        void debug(std::string_view message, _Args&&... args)
         {
             return this->log(log_level::debug, message, std::forward<_Args>(args)...);
         }
@@ -831,7 +5131,7 @@ namespace dtlog
         * @param args Additional arguments for formatting the message.
         */
         template <class ..._Args>
-        void warning(const std::string& message, _Args&&... args)
+        void warning(std::string_view message, _Args&&... args)
         {
             return this->log(log_level::warning, message, std::forward<_Args>(args)...);
         }
@@ -844,7 +5144,7 @@ namespace dtlog
         * @param args Additional arguments for formatting the message.
         */
         template <class ..._Args>
-        void error(const std::string& message, _Args&&... args)
+        void error(std::string_view message, _Args&&... args)
         {
             return this->log(log_level::error, message, std::forward<_Args>(args)...);
         }
@@ -857,101 +5157,525 @@ namespace dtlog
         * @param args Additional arguments for formatting the message.
         */
         template <class ..._Args>
-        void critical(const std::string& message, _Args&&... args)
+        void critical(std::string_view message, _Args&&... args)
         {
             return this->log(log_level::critical, message, std::forward<_Args>(args)...);
         }
 
+        /**
+         * @brief Builds one record with operator<<, like an std::ostream, and logs it when destroyed.
+         *
+         * Values are written with formatter::append() into the per-thread record buffers, without std::ostringstream
+         * for the built-in types. Use the DTLOG_STREAM and DTLOG_INFO style macros, which skip the whole expression
+         * when the level is not logged.
+         */
+        class record_stream
+        {
+        public:
+            /**
+             * @brief Starts a record.
+             * @param owner The logger the record is formatted with. It must outlive the record.
+             * @param level The log level.
+             * @param stream The stream the record is written to.
+             */
+            record_stream(logger& owner, log_level level, FILE* stream = stdout)
+                : m_logger(owner), m_level(level), m_stream(stream), m_site(nullptr), m_buffers(owner.log_resource) {}
+
+            /**
+             * @brief Starts a record counted for a call site.
+             * @param owner The logger the record is formatted with. It must outlive the record.
+             * @param level The log level.
+             * @param site The statement the record is counted for.
+             * @param stream The stream the record is written to.
+             */
+            record_stream(logger& owner, log_level level, call_site& site, FILE* stream = stdout)
+                : m_logger(owner), m_level(level), m_stream(stream), m_site(&site), m_buffers(owner.log_resource) {}
+
+            record_stream(const record_stream&) = delete;
+            record_stream& operator=(const record_stream&) = delete;
+
+            /**
+             * @brief Formats and writes the record.
+             */
+            ~record_stream()
+            {
+                m_logger.pattern(m_level, m_buffers.message().view(), m_buffers.record());
+                m_logger.write_record(m_stream, m_level, m_buffers);
+                if (m_site)
+                    m_site->count(m_buffers.record().size());
+            }
+
+            /**
+             * @brief Appends a value to the message.
+             * @tparam _Ty The type of the value.
+             * @param value The value to append.
+             * @return This record.
+             */
+            template <class _Ty>
+            record_stream& operator<<(const _Ty& value)
+            {
+                formatter::append(m_buffers.message(), value);
+                return *this;
+            }
+
+        private:
+            logger& m_logger;                ///< The logger the record is formatted with.
+            log_level m_level;               ///< The level of the record.
+            FILE* m_stream;                  ///< The stream the record is written to.
+            call_site* m_site;               ///< The statement the record is counted for, or nullptr.
+            detail::record_buffers m_buffers; ///< The buffers the record is built in.
+        };
+
+        /**
+         * @brief Collects many records and writes them as one unit.
+         *
+         * All records of a batch share one timestamp, taken when the batch is created. submit() (called by the
+         * destructor) writes them while holding the stream lock once, switching the color only between runs of
+         * records with the same level, and flushes once. Records are formatted with the pattern of the logger;
+         * colors are used only for stdout and stderr. The logger must outlive the batch.
+         * Records are collected in a buffer kept per thread (see preallocate_thread()), or one reserved with the capacity
+         * argument. Under allocation_policy::truncate that buffer does not grow: the batch submits itself when the next
+         * record or run would not fit, so records are only cut short if one alone is longer than the capacity.
+         */
+        class batch
+        {
+        public:
+            /**
+             * @brief Starts a batch.
+             * @param owner The logger whose name, pattern, labels and memory resource are used.
+             * @param stream The stream the records are written to.
+             * @param capacity The number of characters to reserve for the records. Reserving more than the buffer has
+             * allocates, so call preallocate_thread() with the capacity instead on allocation-free paths.
+             */
+            explicit batch(logger& owner, FILE* stream = stdout, size_t capacity = 0)
+                : m_logger(owner), m_stream(stream), m_time(), m_buffer(owner.log_resource, capacity), m_records(m_buffer.records()),
+                m_runs(m_buffer.runs()), m_fixed(get_allocation_policy() == allocation_policy::truncate)
+            {
+                reset_time();
+            }
+
+            batch(const batch&) = delete;
+            batch& operator=(const batch&) = delete;
+
+            /**
+             * @brief Writes the records that were not submitted yet.
+             */
+            ~batch()
+            {
+                submit();
+            }
+
+            /**
+             * @brief Adds a record to the batch.
+             * @tparam _Args Variadic template for message arguments.
+             * @param level The log level.
+             * @param message The log message.
+             * @param args Additional arguments for formatting the message.
+             */
+            template <class ..._Args>
+            void log(log_level level, std::string_view message, _Args&&... args)
+            {
+                if (!m_logger.should_log(level))
+                    return;
+                detail::record_buffers buffers(m_logger.log_resource);
+                formatter::format_to(buffers.message(), message, std::forward<_Args>(args)...);
+                bool truncated = buffers.message().truncated();
+                if (m_fixed)
+                {
+                    // The fixed buffer cannot grow, so the record is built aside and the batch submitted if it does not fit.
+                    format_buffer& record = buffers.record();
+                    {
+                        DTLOG_STAGE_SCOPE(pattern);
+                        m_logger.pattern(level, buffers.message().view(), record, date_time_formatter(&m_time));
+                    }
+                    const bool new_run = m_runs.size() == 0 || m_runs[m_runs.size() - 1].level != level;
+                    if (m_records.size() + record.size() > m_records.capacity() || (new_run && m_runs.size() == m_runs.capacity()))
+                        submit();
+                    if (m_runs.size() == 0 || m_runs[m_runs.size() - 1].level != level)
+                        m_runs.push_back(run{ m_records.size(), level });
+                    m_records.append(record.view());
+                    truncated |= record.truncated() || m_records.truncated();
+                }
+                else
+                {
+                    if (m_runs.size() == 0 || m_runs[m_runs.size() - 1].level != level)
+                        m_runs.push_back(run{ m_records.size(), level });
+                    DTLOG_STAGE_SCOPE(pattern);
+                    m_logger.pattern(level, buffers.message().view(), m_records, date_time_formatter(&m_time));
+                }
+                ++m_levels[log_level_index(level)];
+                if (truncated)
+                    ++m_truncated;
+                ++m_count;
+            }
+
+            /**
+             * @brief Adds a trace record to the batch.
+             * @tparam _Args Variadic template for message arguments.
+             * @param message The log message.
+             * @param args Additional arguments for formatting the message.
+             */
+            template <class ..._Args>
+            void trace(std::string_view message, _Args&&... args)
+            {
+                log(log_level::trace, message, std::forward<_Args>(args)...);
+            }
+
+            /**
+             * @brief Adds an info record to the batch.
+             * @tparam _Args Variadic template for message arguments.
+             * @param message The log message.
+             * @param args Additional arguments for formatting the message.
+             */
+            template <class ..._Args>
+            void info(std::string_view message, _Args&&... args)
+            {
+                log(log_level::info, message, std::forward<_Args>(args)...);
+            }
+
+            /**
+             * @brief Adds a debug record to the batch.
+             * @tparam _Args Variadic template for message arguments.
+             * @param message The log message.
+             * @param args Additional arguments for formatting the message.
+             */
+            template <class ..._Args>
+            void debug(std::string_view message, _Args&&... args)
+            {
+                log(log_level::debug, message, std::forward<_Args>(args)...);
+            }
+
+            /**
+             * @brief Adds a warning record to the batch.
+             * @tparam _Args Variadic template for message arguments.
+             * @param message The log message.
+             * @param args Additional arguments for formatting the message.
+             */
+            template <class ..._Args>
+            void warning(std::string_view message, _Args&&... args)
+            {
+                log(log_level::warning, message, std::forward<_Args>(args)...);
+            }
+
+            /**
+             * @brief Adds an error record to the batch.
+             * @tparam _Args Variadic template for message arguments.
+             * @param message The log message.
+             * @param args Additional arguments for formatting the message.
+             */
+            template <class ..._Args>
+            void error(std::string_view message, _Args&&... args)
+            {
+                log(log_level::error, message, std::forward<_Args>(args)...);
+            }
+
+            /**
+             * @brief Adds a critical record to the batch.
+             * @tparam _Args Variadic template for message arguments.
+             * @param message The log message.
+             * @param args Additional arguments for formatting the message.
+             */
+            template <class ..._Args>
+            void critical(std::string_view message, _Args&&... args)
+            {
+                log(log_level::critical, message, std::forward<_Args>(args)...);
+            }
+
+            /**
+             * @brief Writes the collected records and starts over with a new timestamp.
+             */
+            void submit()
+            {
+                if (m_count == 0 || !m_stream)
+                    return;
+
+                const bool colored = m_stream == stdout || m_stream == stderr;
+                bool written = true;
+                {
+                    detail::stream_lock lock(m_stream);
+                    for (size_t i = 0; i < m_runs.size(); ++i)
+                    {
+                        const size_t end = i + 1 < m_runs.size() ? m_runs[i + 1].begin : m_records.size();
+                        if (colored)
+                            set_color(m_runs[i].level);
+                        written &= m_logger.log_counters.write(m_stream, m_records.data() + m_runs[i].begin, end - m_runs[i].begin);
+                    }
+                    if (colored)
+                        set_color(log_level::none);
+                    written &= m_logger.log_counters.flush(m_stream);
+                }
+
+                m_logger.log_counters.count_records(m_levels, m_count, written, m_truncated);
+
+                m_records.clear();
+                m_runs.clear();
+                for (size_t& count : m_levels)
+                    count = 0;
+                m_truncated = 0;
+                m_count = 0;
+                reset_time();
+                m_logger.self_report_if_due(m_stream);
+            }
+
+            /**
+             * @brief Gets the number of records waiting to be submitted.
+             * @return The number of records.
+             */
+            DTLOG_NODISCARD size_t size() const
+            {
+                return m_count;
+            }
+
+        private:
+            using run = detail::batch_run; ///< A run of consecutive records with the same level.
+
+            /**
+             * @brief Takes the timestamp shared by the records of the batch.
+             */
+            void reset_time()
+            {
+                m_time = date_time_formatter::local_time(m_logger.current_time());
+            }
+
+            /**
+             * @brief Sets the color of the stream for a level.
+             * @param level The log level.
+             */
+            void set_color(log_level level)
+            {
+                DTLOG_STAGE_SCOPE(color);
+                if (m_stream == stdout)
+                    m_logger.set_stdout_color(level);
+                else
+                    m_logger.set_stderr_color(level);
+            }
+
+            logger& m_logger;                ///< The logger the records are formatted with.
+            FILE* m_stream;                  ///< The stream the records are written to.
+            std::tm m_time;                  ///< The timestamp of the records.
+            detail::batch_buffer m_buffer;   ///< The buffer the records are collected in.
+            format_buffer& m_records;        ///< The formatted records.
+            helper_vector<run, 16>& m_runs;  ///< The runs of records with the same level.
+            bool m_fixed;                    ///< Whether the buffers keep their inline capacity (allocation_policy::truncate).
+            size_t m_levels[log_level_count] = {}; ///< The number of records per level.
+            size_t m_truncated = 0;          ///< The number of records cut short.
+            size_t m_count = 0;              ///< The number of records.
+        };
+
     private:
         /**
          * @brief Formats the log message based on the log pattern.
+         *
+         * The pattern is copied into the output with each %-token replaced; unknown tokens are copied unchanged
+         * and the inserted values are not scanned for further tokens.
          * @param level The log level.
          * @param message The log message.
-         * @param formatted_message The formatted log message.
+         * @param formatted_message The buffer the formatted log message is appended to.
          */
-        void pattern(log_level level, const std::string& message, std::string& formatted_message)
+        void pattern(log_level level, std::string_view message, format_buffer& formatted_message)
         {
-            date_time_formatter time_formatter;
-            formatted_message = log_pattern;
-            size_t pos = 0;
+            DTLOG_STAGE_SCOPE(pattern);
+            pattern(level, message, formatted_message, date_time_formatter(current_time()));
+        }
+
+        /**
+         * @brief Formats the log message based on the log pattern, with the given time.
+         * @param level The log level.
+         * @param message The log message.
+         * @param formatted_message The buffer the formatted log message is appended to.
+         * @param time_formatter The time the date and time tokens are taken from.
+         */
+        void pattern(log_level level, std::string_view message, format_buffer& formatted_message, const date_time_formatter& time_formatter)
+        {
+            const std::string_view pattern_view(log_pattern);
+            size_t start = 0;
 
             while (true)
             {
-                pos = formatted_message.find('%', pos);
-                if (pos == std::string::npos || pos == formatted_message.size() - 1)
-                    break;
-                char token = formatted_message[pos + 1];
-                switch (token)
+                const size_t pos = pattern_view.find('%', start);
+                if (pos == std::string_view::npos || pos == pattern_view.size() - 1)
                 {
-                case 'V':
-                    formatted_message.replace(pos, 2, message);
-                    break;
-                case 'N':
-                    formatted_message.replace(pos, 2, log_name);
-                    break;
-                case 'L':
-                    formatted_message.replace(pos, 2, log_level_to_string(level));
-                    break;
-                case 'A':
-                    formatted_message.replace(pos, 2, time_formatter.full_weekday_name());
-                    break;
-                case 'B':
-                    formatted_message.replace(pos, 2, time_formatter.full_month_name());
-                    break;
-                case 'C':
-                    formatted_message.replace(pos, 2, time_formatter.year_2_digits());
-                    break;
-                case 'Y':
-                    formatted_message.replace(pos, 2, time_formatter.year_4_digits());
-                    break;
-                case 'R':
-                    formatted_message.replace(pos, 2, time_formatter.date_time_representation());
+                    formatted_message.append(pattern_view.substr(start));
                     break;
-                case 'D':
-                    formatted_message.replace(pos, 2, time_formatter.short_MMDDYY_date());
-                    break;
-                case 'm':
-                    formatted_message.replace(pos, 2, time_formatter.month());
-                    break;
-                case 'd':
-                    formatted_message.replace(pos, 2, time_formatter.day_of_month());
-                    break;
-                case 'H':
-                    formatted_message.replace(pos, 2, time_formatter.hours_24_format());
-                    break;
-                case 'h':
-                    formatted_message.replace(pos, 2, time_formatter.hours_12_format());
-                    break;
-                case 'M':
-                    formatted_message.replace(pos, 2, time_formatter.minutes());
+                }
+                formatted_message.append(pattern_view.substr(start, pos - start));
+                start = pos + 2;
+
+                char token = pattern_view[pos + 1];
+                switch (token)
+                {
+                case 'V':
+                    formatted_message.append(message);
                     break;
-                case 'S':
-                    formatted_message.replace(pos, 2, time_formatter.seconds());
+                case 'N':
+                    formatted_message.append(log_name);
                     break;
-                case 'F':
-                    formatted_message.replace(pos, 2, time_formatter.AM_PM());
+                case 'L':
+                    formatted_message.append(log_levels[log_level_index(level)].label);
                     break;
-                case 'x':
-                    formatted_message.replace(pos, 2, time_formatter.clock_12_hour());
+                case 'l':
+                    formatted_message.push_back(log_levels[log_level_index(level)].letter);
                     break;
-                case 'X':
-                    formatted_message.replace(pos, 2, time_formatter.HHMM_time_24_hour());
+                case 'p':
+                    formatted_message.append(log_levels[log_level_index(level)].padded);
                     break;
-                case 'T':
-                    formatted_message.replace(pos, 2, time_formatter.ISO8601_time_format());
+                case 'c':
+                    formatted_message.append(log_levels[log_level_index(level)].colored);
                     break;
                 case '%':
-                    formatted_message.replace(pos, 2, "%");
+                    formatted_message.push_back('%');
                     break;
                 case 'n':
-                    formatted_message.replace(pos, 2, "\n");
+                    formatted_message.push_back('\n');
                     break;
                 default:
+                    if (!time_formatter.append_token(formatted_message, token))
+                        formatted_message.append(pattern_view.substr(pos, 2));
                     break;
                 }
             }
         }
 
+        /**
+         * @brief Reads the clock of this logger.
+         * @return The current calendar time.
+         */
+        std::time_t current_time() const
+        {
+            return log_clock ? log_clock->now() : std::time(nullptr);
+        }
+
+        /**
+         * @brief Formats every line of a message based on the log pattern, with one timestamp.
+         *
+         * Lines are found with std::memchr. Every line but the last ends with a newline, added after the pattern if
+         * the pattern does not end with one; a newline at the end of the message ends the last line.
+         * @param level The log level.
+         * @param text The formatted message.
+         * @param formatted_message The buffer the formatted lines are appended to.
+         */
+        void pattern_lines(log_level level, std::string_view text, format_buffer& formatted_message)
+        {
+            DTLOG_STAGE_SCOPE(pattern);
+            const date_time_formatter time_formatter(current_time());
+            size_t start = 0;
+            while (true)
+            {
+                const char* newline = start < text.size() ? static_cast<const char*>(std::memchr(text.data() + start, '\n', text.size() - start)) : nullptr;
+                const size_t end = newline ? static_cast<size_t>(newline - text.data()) : text.size();
+                pattern(level, text.substr(start, end - start), formatted_message, time_formatter);
+                if (!newline)
+                    break;
+                if (formatted_message.size() == 0 || formatted_message.data()[formatted_message.size() - 1] != '\n')
+                    formatted_message.push_back('\n');
+                start = end + 1;
+                if (start == text.size())
+                    break;
+            }
+        }
+
+        /**
+         * @brief Writes a record, holding the stream lock for the whole record. Records to stdout and stderr are
+         * written in the color of their level.
+         * @param stream The stream to write to.
+         * @param level The log level.
+         * @param buffers The buffers holding the formatted record.
+         */
+        void write_record(FILE* stream, log_level level, detail::record_buffers& buffers)
+        {
+            if (!stream)
+            {
+                log_counters.count_record(level, false, buffers.truncated());
+                return;
+            }
+            {
+                const format_buffer& record = buffers.record();
+                detail::stream_lock lock(stream);
+                set_stream_color(stream, level);
+                const bool written = log_counters.write(stream, record.data(), record.size());
+                const bool flushed = log_counters.flush(stream);
+                set_stream_color(stream, log_level::none);
+                log_counters.count_record(level, written && flushed, buffers.truncated());
+            }
+            self_report_if_due(stream);
+        }
+
+        /**
+         * @brief Writes the summary record of set_self_report_interval() if it is due. Of the threads that find it
+         * due, only the one that moves the due time forward writes it.
+         * @param stream The stream of the record that found it due; the summary is written there, whatever the level
+         * threshold.
+         */
+        void self_report_if_due(FILE* stream)
+        {
+            const std::uint64_t interval = log_self_report.interval_ns.load();
+            if (interval == 0)
+                return;
+            const std::uint64_t now = detail::self_report_state::now_ns();
+            std::uint64_t due = log_self_report.due_ns.load();
+            if (now < due || !log_self_report.due_ns.compare_exchange(due, now + interval))
+                return;
+
+            const logger_stats current = log_counters.snapshot();
+            const std::uint64_t elapsed = now - log_self_report.last_ns.load();
+            const std::uint64_t records = current.total_records() - log_self_report.last_records.load();
+            const std::uint64_t bytes = current.bytes_written - log_self_report.last_bytes.load();
+            const std::uint64_t drops = current.drops - log_self_report.last_drops.load();
+            log_self_report.last_ns.store(now);
+            log_self_report.last_records.store(current.total_records());
+            log_self_report.last_bytes.store(current.bytes_written);
+            log_self_report.last_drops.store(current.drops);
+
+            const double seconds = elapsed ? static_cast<double>(elapsed) / 1e9 : 1.0;
+            detail::record_buffers buffers(log_resource);
+            formatter::format_to(buffers.message(), "self-report: {0} records/s, {1} bytes/s, {2} drops, queue depth {3} over the last {4} ms",
+                static_cast<std::uint64_t>(static_cast<double>(records) / seconds + 0.5),
+                static_cast<std::uint64_t>(static_cast<double>(bytes) / seconds + 0.5),
+                drops, current.queue_high_water_mark, elapsed / 1000000);
+            pattern(log_level::info, buffers.message().view(), buffers.record());
+            write_record(stream, log_level::info, buffers);
+        }
+
+        /**
+         * @brief Sets the color of stdout or stderr based on the log level. Other streams are not colored.
+         * @param stream The stream.
+         * @param level The log level.
+         */
+        void set_stream_color(FILE* stream, log_level level)
+        {
+            DTLOG_STAGE_SCOPE(color);
+            if (stream == stdout)
+                set_stdout_color(level);
+            else if (stream == stderr)
+                set_stderr_color(level);
+        }
+
+        /**
+         * @brief Renders the padded and colored label and the short letter of every level from its label.
+         */
+        void render_level_fragments()
+        {
+            size_t width = 0;
+            for (const level_fragments& fragments : log_levels)
+                width = fragments.label.size() > width ? fragments.label.size() : width;
+
+            for (size_t i = 0; i < log_level_count; ++i)
+            {
+                level_fragments& fragments = log_levels[i];
+                fragments.padded = fragments.label;
+                fragments.padded.resize(width, ' ');
+#ifdef _WIN32
+                fragments.colored = fragments.label;
+#else // _WIN32
+                fragments.colored = std::string(log_level_ansi_color(static_cast<log_level>(i)));
+                fragments.colored += fragments.label;
+                fragments.colored += log_level_ansi_color(log_level::none);
+#endif // _WIN32
+                const char first = fragments.label.empty() ? ' ' : fragments.label[0];
+                fragments.letter = (first >= 'a' && first <= 'z') ? static_cast<char>(first - 'a' + 'A') : first;
+            }
+        }
+
 #ifdef _WIN32
         /**
          * @brief Sets the color for standard output based on the log level.
@@ -1035,76 +5759,442 @@ namespace dtlog
         * @brief Sets the color for standard output based on the log level.
         * @param level The log level.
         */
-        void set_stdout_color(log_level level);
+        void set_stdout_color(log_level level)
         {
-            const char* color_code = "\x1b[0m";
-        
-            switch (level)
-            {
-            case log_level::none:
-            case log_level::trace:
-                break;
-            case log_level::info:
-                color_code = "\x1b[32m";
-                break;
-            case log_level::debug:
-                color_code = "\x1b[34m";
-                break;
-            case log_level::warning:
-                color_code = "\x1b[33m";
-                break;
-            case log_level::error:
-                color_code = "\x1b[31m";
-                break;
-            case log_level::critical:
-                color_code = "\x1b[91m";
-                break;
-            default:
-                break;
-            }
-        
-            fwrite(color_code, sizeof(char), strlen(color_code), stdout);
+            const std::string_view color_code = log_level_ansi_color(level);
+            fwrite(color_code.data(), sizeof(char), color_code.size(), stdout);
         }
-        
+
         /**
          * @brief Sets the color for standard error output based on the log level.
          * @param level The log level.
          */
         void set_stderr_color(log_level level)
         {
-            const char* color_code = "\x1b[0m";
-        
-            switch (level)
+            const std::string_view color_code = log_level_ansi_color(level);
+            fwrite(color_code.data(), sizeof(char), color_code.size(), stderr);
+        }
+
+#endif // _WIN32
+
+    private:
+        std::string log_name;           // The name of the logger
+        std::string log_pattern;        // The log message pattern
+        memory_resource* log_resource;  // The memory resource for batches and nested records (nullptr for std::malloc)
+        log_level log_threshold;        // The lowest level that is logged
+        detail::logger_counters log_counters; // The counters read by stats()
+        detail::self_report_state log_self_report; // The schedule of the summary records of set_self_report_interval()
+        trace_sink* log_trace_sink = nullptr; // The sink the spans of scoped timers are written to (nullptr for none)
+        clock_source* log_clock = nullptr; // The clock of the date and time tokens (nullptr for std::time)
+
+        /**
+         * @brief The prerendered pattern fragments of one log level.
+         */
+        struct level_fragments
+        {
+            std::string label;   // The label (%L)
+            std::string padded;  // The label padded to the longest label (%p)
+            std::string colored; // The label in its ANSI color (%c); the plain label on Windows
+            char letter = ' ';   // The upper-case first character of the label (%l)
+        };
+
+        level_fragments log_levels[log_level_count]; // The fragments of every level, indexed by log_level_index()
+
+        template <class ..._Args>
+        friend class scoped_timer;
+    };
+
+    /**
+     * @brief Writes spans as Chrome trace events (JSON), which Perfetto and chrome://tracing display on a timeline.
+     *
+     * Every span becomes a complete ("X") event with its name, start, duration, process id and thread id. Events are
+     * appended to a chunk under a mutex, and the chunk is written when it reaches chunk_size, on flush() and when the
+     * sink is destroyed, which also closes the JSON array. Attach it to a logger with logger::set_trace_sink() to trace
+     * every scoped_timer of the logger, or call complete() directly.
+     */
+    class trace_sink
+    {
+    public:
+        static constexpr size_t chunk_size = 64 * 1024; ///< The size at which a chunk of events is written.
+
+        /**
+         * @brief Creates a trace file, replacing an existing one.
+         * @param filename The name of the file.
+         */
+        explicit trace_sink(const std::string& filename) : trace_sink(std::fopen(filename.c_str(), "w"), true) {}
+
+        /**
+         * @brief Writes the trace to an open stream, which is not closed by the sink.
+         * @param stream The stream.
+         */
+        explicit trace_sink(FILE* stream) : trace_sink(stream, false) {}
+
+        trace_sink(const trace_sink&) = delete;
+        trace_sink& operator=(const trace_sink&) = delete;
+
+        /**
+         * @brief Writes the remaining events, closes the JSON array and closes the file if the sink opened it.
+         */
+        ~trace_sink()
+        {
+            if (!m_stream)
+                return;
+            m_chunk.append("\n]\n", 3);
+            flush();
+            if (m_owned)
+                std::fclose(m_stream);
+        }
+
+        /**
+         * @brief Checks whether the trace file could be opened.
+         * @return True if events are written.
+         */
+        DTLOG_NODISCARD bool is_open() const
+        {
+            return m_stream != nullptr;
+        }
+
+        /**
+         * @brief Adds a span that has ended.
+         * @param name The name of the span.
+         * @param start The time the span started.
+         * @param duration The length of the span.
+         */
+        void complete(std::string_view name, std::chrono::steady_clock::time_point start, std::chrono::nanoseconds duration)
+        {
+            if (!m_stream)
+                return;
+            const std::uint64_t thread_id = current_thread_id();
+            const std::chrono::nanoseconds start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch());
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_chunk.append(m_events ? ",\n{\"name\":\"" : "\n{\"name\":\"", m_events ? 11 : 10);
+            append_json(m_chunk, name);
+            m_chunk.append("\",\"cat\":\"dtlog\",\"ph\":\"X\",\"ts\":", 30);
+            append_microseconds(m_chunk, start_ns);
+            m_chunk.append(",\"dur\":", 7);
+            append_microseconds(m_chunk, duration);
+            m_chunk.append(",\"pid\":", 7);
+            detail::write_integer(m_chunk, m_process_id);
+            m_chunk.append(",\"tid\":", 7);
+            detail::write_integer(m_chunk, thread_id);
+            m_chunk.push_back('}');
+            ++m_events;
+            if (m_chunk.size() >= chunk_size)
+                write_chunk();
+        }
+
+        /**
+         * @brief Writes the events collected so far.
+         */
+        void flush()
+        {
+            if (!m_stream)
+                return;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            write_chunk();
+            std::fflush(m_stream);
+        }
+
+        /**
+         * @brief Gets the number of events added.
+         * @return The count.
+         */
+        DTLOG_NODISCARD size_t event_count() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_events;
+        }
+
+    private:
+        trace_sink(FILE* stream, bool owned) : m_stream(stream), m_owned(owned), m_process_id(current_process_id())
+        {
+            m_chunk.reserve(chunk_size + 1024);
+            m_chunk.push_back('[');
+        }
+
+        /**
+         * @brief Writes the chunk to the stream and empties it. The mutex must be held.
+         */
+        void write_chunk()
+        {
+            std::fwrite(m_chunk.data(), sizeof(char), m_chunk.size(), m_stream);
+            m_chunk.clear();
+        }
+
+        /**
+         * @brief Appends a string as the body of a JSON string.
+         * @param out The buffer.
+         * @param text The string.
+         */
+        static void append_json(format_buffer& out, std::string_view text)
+        {
+            constexpr char hex[] = "0123456789abcdef";
+            for (char c : text)
             {
-            case log_level::none:
-            case log_level::trace:
-                break;
-            case log_level::info:
-                color_code = "\x1b[32m";
-                break;
-            case log_level::debug:
-                color_code = "\x1b[34m";
-                break;
-            case log_level::warning:
-                color_code = "\x1b[33m";
-                break;
-            case log_level::error:
-                color_code = "\x1b[31m";
-                break;
-            case log_level::critical:
-                color_code = "\x1b[91m";
-                break;
-            default:
-                break;
+                const unsigned char code = static_cast<unsigned char>(c);
+                if (c == '"' || c == '\\')
+                {
+                    out.push_back('\\');
+                    out.push_back(c);
+                }
+                else if (code < 0x20)
+                {
+                    const char escape[6] = { '\\', 'u', '0', '0', hex[code >> 4], hex[code & 0xF] };
+                    out.append(escape, 6);
+                }
+                else
+                {
+                    out.push_back(c);
+                }
             }
-        
-            fwrite(color_code, sizeof(char), strlen(color_code), stderr);
         }
 
+        /**
+         * @brief Appends nanoseconds as microseconds with three decimals, the unit of trace events.
+         * @param out The buffer.
+         * @param value The time.
+         */
+        static void append_microseconds(format_buffer& out, std::chrono::nanoseconds value)
+        {
+            const std::uint64_t ns = value.count() > 0 ? static_cast<std::uint64_t>(value.count()) : 0;
+            const std::uint64_t fraction = ns % 1000;
+            detail::write_integer(out, ns / 1000);
+            out.push_back('.');
+            out.push_back(static_cast<char>('0' + fraction / 100));
+            out.push_back(static_cast<char>('0' + fraction / 10 % 10));
+            out.push_back(static_cast<char>('0' + fraction % 10));
+        }
+
+#ifdef _WIN32
+        /**
+         * @brief Gets the id of the process.
+         * @return The process id.
+         */
+        static std::uint64_t current_process_id()
+        {
+            return static_cast<std::uint64_t>(GetCurrentProcessId());
+        }
+
+        /**
+         * @brief Gets the id the operating system uses for the calling thread.
+         * @return The thread id.
+         */
+        static std::uint64_t current_thread_id()
+        {
+            return static_cast<std::uint64_t>(GetCurrentThreadId());
+        }
+#else // _WIN32
+        /**
+         * @brief Gets the id of the process.
+         * @return The process id.
+         */
+        static std::uint64_t current_process_id()
+        {
+            return static_cast<std::uint64_t>(getpid());
+        }
+
+        /**
+         * @brief Gets the id the operating system uses for the calling thread.
+         * @return The thread id.
+         */
+        static std::uint64_t current_thread_id()
+        {
+            static thread_local const std::uint64_t id = []
+            {
+#if defined(__linux__)
+                return static_cast<std::uint64_t>(syscall(SYS_gettid));
+#elif defined(__APPLE__)
+                std::uint64_t thread_id = 0;
+                pthread_threadid_np(nullptr, &thread_id);
+                return thread_id;
+#else // __linux__
+                return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(pthread_self()));
+#endif // __linux__
+            }();
+            return id;
+        }
 #endif // _WIN32
 
+        mutable std::mutex m_mutex;  ///< Guards the chunk and the event count.
+        FILE* m_stream;              ///< The stream the trace is written to, or nullptr if it could not be opened.
+        bool m_owned;                ///< True if the sink opened the stream and closes it.
+        std::uint64_t m_process_id;  ///< The id of the process.
+        format_buffer m_chunk;       ///< The events not written yet.
+        size_t m_events = 0;         ///< The number of events added.
+    };
+
+    /**
+     * @brief Logs how long a scope took when it ends: "<message> took 12.345 ms".
+     *
+     * The constructor reads the steady clock and captures the arguments of the message by value (strings are copied
+     * once), so temporaries can be passed. The destructor reads the clock again; only if the elapsed time reaches the
+     * threshold and the level is logged are the message and the duration formatted and written, so fast scopes cost
+     * two clock reads. If the logger has a trace_sink, every timer is also written to it as a span named after the
+     * message, whatever the threshold. The logger and the format string must outlive the timer.
+     * @code
+     * dtlog::scoped_timer timer(log, std::chrono::milliseconds(5), "db query {0}", id); // only queries of 5 ms or more
+     * @endcode
+     * @tparam _Args The forwarded types of the message arguments; deduced.
+     */
+    template <class ..._Args>
+    class scoped_timer
+    {
+    public:
+        /**
+         * @brief Starts a timer that always logs.
+         * @param owner The logger.
+         * @param message The format string of the message.
+         * @param args The arguments of the message.
+         */
+        explicit scoped_timer(logger& owner, std::string_view message, _Args&&... args)
+            : scoped_timer(owner, std::chrono::nanoseconds::zero(), message, std::forward<_Args>(args)...) {}
+
+        /**
+         * @brief Starts a timer that logs only slow scopes.
+         * @param owner The logger.
+         * @param threshold The shortest elapsed time that is logged.
+         * @param message The format string of the message.
+         * @param args The arguments of the message.
+         */
+        scoped_timer(logger& owner, std::chrono::nanoseconds threshold, std::string_view message, _Args&&... args)
+            : m_logger(owner), m_message(message), m_arguments(detail::capture_argument<true>(std::forward<_Args>(args))...),
+            m_threshold(threshold), m_start(std::chrono::steady_clock::now()) {}
+
+        scoped_timer(const scoped_timer&) = delete;
+        scoped_timer& operator=(const scoped_timer&) = delete;
+
+        /**
+         * @brief Logs the elapsed time if it reaches the threshold.
+         */
+        ~scoped_timer()
+        {
+            if (m_dismissed)
+                return;
+            const std::chrono::nanoseconds duration = elapsed();
+            trace_sink* sink = m_logger.log_trace_sink;
+            const bool logged = duration >= m_threshold && m_logger.should_log(m_level);
+            if (!logged && !sink)
+                return;
+
+            detail::record_buffers buffers(m_logger.log_resource);
+            std::apply([&](const auto&... captured) { formatter::format_to(buffers.message(), m_message, captured...); }, m_arguments);
+            if (sink)
+                sink->complete(buffers.message().view(), m_start, duration);
+            if (!logged)
+                return;
+            buffers.message().append(" took ", 6);
+            detail::write_duration(buffers.message(), duration);
+            m_logger.pattern(m_level, buffers.message().view(), buffers.record());
+            m_logger.write_record(stdout, m_level, buffers);
+        }
+
+        /**
+         * @brief Gets the time since the timer started.
+         * @return The elapsed time.
+         */
+        DTLOG_NODISCARD std::chrono::nanoseconds elapsed() const
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start);
+        }
+
+        /**
+         * @brief Sets the level the duration is logged at.
+         * @param level The log level; log_level::info by default.
+         */
+        void set_level(log_level level)
+        {
+            m_level = level;
+        }
+
+        /**
+         * @brief Keeps the timer from logging, for example when the operation failed and is logged elsewhere.
+         */
+        void dismiss()
+        {
+            m_dismissed = true;
+        }
+
     private:
-        std::string log_name;       // The name of the logger
-        std::string log_pattern;    // The log message pattern
+        logger& m_logger;                                                   ///< The logger the duration is written with.
+        std::string_view m_message;                                         ///< The format string of the message.
+        std::tuple<detail::argument_capture_t<_Args, true>...> m_arguments; ///< The owned arguments of the message.
+        std::chrono::nanoseconds m_threshold;                               ///< The shortest elapsed time that is logged.
+        std::chrono::steady_clock::time_point m_start;                      ///< The time the timer started.
+        log_level m_level = log_level::info;                                ///< The level the duration is logged at.
+        bool m_dismissed = false;                                           ///< True if the timer does not log.
     };
+
+    template <class ..._Args>
+    scoped_timer(logger&, std::string_view, _Args&&...) -> scoped_timer<_Args...>;
+
+    template <class _Rep, class _Period, class ..._Args>
+    scoped_timer(logger&, std::chrono::duration<_Rep, _Period>, std::string_view, _Args&&...) -> scoped_timer<_Args...>;
+
+    /**
+     * @brief Prepares the calling thread for logging so its first record is not slower than the others.
+     *
+     * Grows the per-thread record buffers to record_capacity and the per-thread batch buffer to batch_capacity and
+     * touches their pages, and creates the per-thread parse cache. Call it at the start of every thread that logs on
+     * a latency-sensitive path.
+     * @param record_capacity The number of characters the longest expected record needs.
+     * @param batch_capacity The number of characters the largest expected logger::batch needs, or 0 for none.
+     */
+    inline void preallocate_thread(size_t record_capacity = 4096, size_t batch_capacity = 0)
+    {
+        detail::record_buffers::preallocate_thread(record_capacity);
+        detail::batch_buffer::preallocate_thread(batch_capacity);
+        formatter::preallocate_thread();
+    }
+
+    /**
+     * @brief Prepares the process and the calling thread for logging.
+     *
+     * Loads the time zone data used by the date and time tokens, then calls preallocate_thread().
+     * @param record_capacity The number of characters the longest expected record needs.
+     * @param batch_capacity The number of characters the largest expected logger::batch needs, or 0 for none.
+     */
+    inline void preallocate(size_t record_capacity = 4096, size_t batch_capacity = 0)
+    {
+        date_time_formatter time_formatter;
+        (void)time_formatter;
+        preallocate_thread(record_capacity, batch_capacity);
+    }
 } // namespace dtlog
+
+/**
+ * @brief Starts a record of the given level built with operator<<; nothing after it is evaluated if the level is not logged.
+ * @param logger_object The logger.
+ * @param level The log level.
+ */
+#define DTLOG_STREAM(logger_object, level) \
+    !(logger_object).should_log(level) ? (void)0 : ::dtlog::detail::stream_voidify() & ::dtlog::logger::record_stream((logger_object), (level), DTLOG_CALL_SITE())
+
+/**
+ * @brief Gets the call_site of the statement it appears in: a function-local static created on first use.
+ */
+#define DTLOG_CALL_SITE() \
+    [](const char* dtlog_function) -> ::dtlog::call_site& { static ::dtlog::call_site dtlog_site(__FILE__, __LINE__, dtlog_function); return dtlog_site; }(__func__)
+
+/**
+ * @brief Logs a formatted message, counting it for the statement; see dump_call_sites().
+ * @param logger_object The logger.
+ * @param level The log level.
+ * @param ... The format string and its arguments.
+ */
+#define DTLOG_LOG(logger_object, level, ...) \
+    ((logger_object).should_log(level) ? (logger_object).log_at(DTLOG_CALL_SITE(), (level), __VA_ARGS__) : (void)0)
+
+/**
+ * @brief Wraps a printf format string literal so logf() and formatter::printf_to() check it at compile time with C++17 too.
+ * @param literal The format string literal.
+ */
+#define DTLOG_PRINTF(literal) \
+    [] { struct dtlog_printf_string : ::dtlog::detail::compile_time_printf_string { static constexpr std::string_view get() { return literal; } }; return dtlog_printf_string(); }()
+
+#define DTLOG_TRACE(logger_object) DTLOG_STREAM(logger_object, ::dtlog::log_level::trace)       // @brief Starts a trace record.
+#define DTLOG_INFO(logger_object) DTLOG_STREAM(logger_object, ::dtlog::log_level::info)         // @brief Starts an info record.
+#define DTLOG_DEBUG(logger_object) DTLOG_STREAM(logger_object, ::dtlog::log_level::debug)       // @brief Starts a debug record.
+#define DTLOG_WARNING(logger_object) DTLOG_STREAM(logger_object, ::dtlog::log_level::warning)   // @brief Starts a warning record.
+#define DTLOG_ERROR(logger_object) DTLOG_STREAM(logger_object, ::dtlog::log_level::error)       // @brief Starts an error record.
+#define DTLOG_CRITICAL(logger_object) DTLOG_STREAM(logger_object, ::dtlog::log_level::critical) // @brief Starts a critical record.
@@ -0,0 +1,170 @@
+/*
+ * This file is part of the dtlog library, originally created by Tynes0.
+ * For the latest version and updates, please visit the official dtlog GitHub repository:
+ * https://github.com/tynes0/dtlog
+ *
+ * dtlog is a basic library for logging, providing fast and user-friendly use
+ * It is released under the Apache License 2.0. See the LICENSE file in the root of the dtlog repository
+ * or visit the above GitHub link for more details.
+ *
+ * For contributions, bug reports, or other inquiries, feel free to contact the author:
+ * - GitHub: https://github.com/tynes0
+ * - Email: cihanbilgihan@gmail.com
+ */
+
+
+
+#include "dtlog.h"
+
+#include <cstdio>     // @brief Include for std::freopen and std::fprintf.
+#include <cstdlib>    // @brief Include for std::malloc and std::free.
+#include <new>        // @brief Include for std::bad_alloc and std::align_val_t.
+#include <string>     // @brief Include for std::string.
+
+namespace
+{
+    bool g_counting = false;   ///< Whether allocations are counted.
+    size_t g_allocations = 0;  ///< The allocations counted since the last reset.
+
+    /**
+     * @brief Allocates for the replaced operator new and counts the call.
+     * @param size The number of bytes.
+     * @return The block.
+     */
+    void* counted_new(size_t size)
+    {
+        if (g_counting)
+            ++g_allocations;
+        if (void* block = std::malloc(size ? size : 1))
+            return block;
+        throw std::bad_alloc();
+    }
+} // namespace
+
+void* operator new(size_t size) { return counted_new(size); }
+void* operator new[](size_t size) { return counted_new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { try { return counted_new(size); } catch (...) { return nullptr; } }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { try { return counted_new(size); } catch (...) { return nullptr; } }
+void operator delete(void* block) noexcept { std::free(block); }
+void operator delete[](void* block) noexcept { std::free(block); }
+void operator delete(void* block, size_t) noexcept { std::free(block); }
+void operator delete[](void* block, size_t) noexcept { std::free(block); }
+
+#if defined(__GLIBC__)
+// dtlog's buffers grow with std::malloc and std::realloc; glibc lets the program replace them and forward to its own.
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* block, size_t size);
+
+    void* malloc(size_t size)
+    {
+        if (g_counting)
+            ++g_allocations;
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        if (g_counting)
+            ++g_allocations;
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* block, size_t size)
+    {
+        if (g_counting)
+            ++g_allocations;
+        return __libc_realloc(block, size);
+    }
+}
+#define DTLOG_TEST_COUNTS_MALLOC 1 // @brief std::malloc, std::calloc and std::realloc are counted as well.
+#else // __GLIBC__
+#define DTLOG_TEST_COUNTS_MALLOC 0 // @brief Only operator new is counted.
+#endif // __GLIBC__
+
+namespace
+{
+    int g_failures = 0; ///< The number of checks that allocated.
+
+    /**
+     * @brief Runs a statement and reports it if it allocated.
+     * @tparam _Fn The type of the statement.
+     * @param policy The name of the allocation policy in effect.
+     * @param name The name of the check.
+     * @param statement The statement.
+     */
+    template <class _Fn>
+    void expect_no_allocation(const char* policy, const char* name, _Fn&& statement)
+    {
+        g_allocations = 0;
+        g_counting = true;
+        statement();
+        g_counting = false;
+        if (g_allocations != 0)
+        {
+            ++g_failures;
+            std::fprintf(stderr, "FAIL [%s] %s: %zu allocations\n", policy, name, g_allocations);
+        }
+        else
+        {
+            std::fprintf(stderr, "ok   [%s] %s\n", policy, name);
+        }
+    }
+
+    /**
+     * @brief Checks every logging path of the logger under the current allocation policy.
+     * @param policy The name of the allocation policy in effect.
+     * @param log The logger.
+     */
+    void check_logging(const char* policy, dtlog::logger& log)
+    {
+        const std::string text = "a std::string argument";
+        const std::string_view view = "a std::string_view argument";
+        const char* c_string = "a const char* argument";
+
+        expect_no_allocation(policy, "log() without arguments", [&] { log.info("no arguments"); });
+        expect_no_allocation(policy, "log() with int", [&] { log.info("int {0}", 42); });
+        expect_no_allocation(policy, "log() with double", [&] { log.warning("double {0}", 3.25); });
+        expect_no_allocation(policy, "log() with const char*", [&] { log.error("const char* {0}", c_string); });
+        expect_no_allocation(policy, "log() with std::string_view", [&] { log.debug("std::string_view {0}", view); });
+        expect_no_allocation(policy, "log() with std::string", [&] { log.critical("std::string {0}", text); });
+        expect_no_allocation(policy, "log() with every type", [&] { log.info("{0} {1} {2} {3} {4}", 42, 3.25, c_string, view, text); });
+        expect_no_allocation(policy, "DTLOG_INFO stream", [&] { DTLOG_INFO(log) << "stream " << 42 << ' ' << 3.25 << ' ' << c_string << ' ' << view << ' ' << text; });
+        expect_no_allocation(policy, "DTLOG_LOG", [&] { DTLOG_LOG(log, dtlog::log_level::warning, "counted {0} {1}", 42, text); });
+        expect_no_allocation(policy, "batch", [&] {
+            dtlog::logger::batch records(log);
+            for (int i = 0; i < 100; ++i)
+                records.log(i % 2 ? dtlog::log_level::info : dtlog::log_level::error, "batch record {0} {1}", i, view);
+        });
+    }
+} // namespace
+
+int main()
+{
+#ifdef _WIN32
+    const char* null_device = "NUL";
+#else // _WIN32
+    const char* null_device = "/dev/null";
+#endif // _WIN32
+    if (!std::freopen(null_device, "w", stdout))
+        return 1;
+
+    dtlog::logger log("allocation_test", "[%T] %N %p: %V%n");
+    // Room for 100 batch records, so the batch check is not limited by the inline buffer.
+    dtlog::preallocate(4096, 16 * 1024);
+    // The C library allocates the buffer of a stdio stream on its first write; that is not dtlog's allocation.
+    std::fputs("warm-up\n", stdout);
+    std::fflush(stdout);
+
+    dtlog::set_allocation_policy(dtlog::allocation_policy::grow);
+    check_logging("grow", log);
+    dtlog::set_allocation_policy(dtlog::allocation_policy::truncate);
+    check_logging("truncate", log);
+    dtlog::set_allocation_policy(dtlog::allocation_policy::grow);
+
+    if (!DTLOG_TEST_COUNTS_MALLOC)
+        std::fprintf(stderr, "note: only operator new is counted on this platform\n");
+    return g_failures == 0 ? 0 : 1;
+}
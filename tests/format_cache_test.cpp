@@ -0,0 +1,83 @@
+/*
+ * This file is part of the dtlog library, originally created by Tynes0.
+ * For the latest version and updates, please visit the official dtlog GitHub repository:
+ * https://github.com/tynes0/dtlog
+ *
+ * dtlog is a basic library for logging, providing fast and user-friendly use
+ * It is released under the Apache License 2.0. See the LICENSE file in the root of the dtlog repository
+ * or visit the above GitHub link for more details.
+ *
+ * For contributions, bug reports, or other inquiries, feel free to contact the author:
+ * - GitHub: https://github.com/tynes0
+ * - Email: cihanbilgihan@gmail.com
+ */
+
+
+
+#include "dtlog.h"
+
+#include <cstdio>     // @brief Include for std::fprintf.
+#include <string>     // @brief Include for std::string.
+
+namespace
+{
+    int g_failures = 0; ///< The number of checks that failed.
+
+    /**
+     * @brief Reports a check.
+     * @param name The name of the check.
+     * @param actual The text that was produced.
+     * @param expected The text that was expected.
+     */
+    void expect_equal(const char* name, const std::string& actual, const std::string& expected)
+    {
+        if (actual != expected)
+        {
+            ++g_failures;
+            std::fprintf(stderr, "FAIL %s: \"%s\", expected \"%s\"\n", name, actual.c_str(), expected.c_str());
+        }
+        else
+        {
+            std::fprintf(stderr, "ok   %s\n", name);
+        }
+    }
+
+    /**
+     * @brief Formats a printf-style message into a string.
+     * @tparam _Args The types of the arguments.
+     * @param fmt The format string.
+     * @param args The arguments.
+     * @return The formatted message.
+     */
+    template <class ..._Args>
+    std::string printf_string(std::string_view fmt, const _Args&... args)
+    {
+        dtlog::format_buffer out;
+        dtlog::formatter::printf_to(out, dtlog::runtime_printf(fmt), args...);
+        return out.str();
+    }
+} // namespace
+
+int main()
+{
+    // The cached segments of a format string are keyed by its address and length; a buffer overwritten in place with
+    // text of the same length must not reuse them.
+    std::string pattern = "Processing {0} then {1} items now";
+    expect_equal("format: first text", dtlog::formatter::format(pattern, "A", "B"), "Processing A then B items now");
+    pattern[12] = '1';
+    pattern[21] = '0';
+    expect_equal("format: buffer overwritten in place", dtlog::formatter::format(pattern, "A", "B"), "Processing B then A items now");
+    pattern[12] = '0';
+    pattern[21] = '1';
+    expect_equal("format: original text again", dtlog::formatter::format(pattern, "A", "B"), "Processing A then B items now");
+
+    // The result of the printf check is cached the same way.
+    std::string printf_pattern = "Processing %d then %s items now";
+    expect_equal("printf: first text", printf_string(printf_pattern, 7, "eight"), "Processing 7 then eight items now");
+    printf_pattern[12] = 's';
+    printf_pattern[20] = 'd';
+    expect_equal("printf: buffer overwritten in place", printf_string(printf_pattern, 7, "eight"),
+        "Processing %s then %d items now [dtlog::printf_format: a conversion does not match the type of its argument]");
+
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+/*
+ * This file is part of the dtlog library, originally created by Tynes0.
+ * For the latest version and updates, please visit the official dtlog GitHub repository:
+ * https://github.com/tynes0/dtlog
+ *
+ * dtlog is a basic library for logging, providing fast and user-friendly use
+ * It is released under the Apache License 2.0. See the LICENSE file in the root of the dtlog repository
+ * or visit the above GitHub link for more details.
+ *
+ * For contributions, bug reports, or other inquiries, feel free to contact the author:
+ * - GitHub: https://github.com/tynes0
+ * - Email: cihanbilgihan@gmail.com
+ */
+
+
+
+#include "dtlog_ho.h"
+
+#include <string>     // @brief Include for std::string.
+
+/**
+ * @brief Formats a record in this translation unit.
+ * @return The formatted record.
+ */
+std::string format_in_second_unit()
+{
+    dtlog::logger log("second", "%L %N: %V\n");
+    dtlog::format_buffer message;
+    dtlog::formatter::format_to(message, "{0}", 42);
+    dtlog::format_buffer record;
+    log.format_record(dtlog::log_level::info, message.view(), record);
+    return record.str();
+}
@@ -0,0 +1,101 @@
+/*
+ * This file is part of the dtlog library, originally created by Tynes0.
+ * For the latest version and updates, please visit the official dtlog GitHub repository:
+ * https://github.com/tynes0/dtlog
+ *
+ * dtlog is a basic library for logging, providing fast and user-friendly use
+ * It is released under the Apache License 2.0. See the LICENSE file in the root of the dtlog repository
+ * or visit the above GitHub link for more details.
+ *
+ * For contributions, bug reports, or other inquiries, feel free to contact the author:
+ * - GitHub: https://github.com/tynes0
+ * - Email: cihanbilgihan@gmail.com
+ */
+
+
+
+// Builds the header-only variant, which no other target compiles, and checks that it formats like dtlog.h.
+// header_only_second.cpp includes it in a second translation unit, so definitions that are not inline fail to link.
+
+#include "dtlog_ho.h"
+
+#include <cstdio>     // @brief Include for std::fprintf and std::tmpfile.
+#include <string>     // @brief Include for std::string.
+#include <vector>     // @brief Include for std::vector.
+
+/**
+ * @brief Formats a record in the second translation unit.
+ * @return The formatted record.
+ */
+std::string format_in_second_unit();
+
+namespace
+{
+    int g_failures = 0; ///< The number of checks that failed.
+
+    /**
+     * @brief Reports a check.
+     * @param name The name of the check.
+     * @param actual The text that was produced.
+     * @param expected The text that was expected.
+     */
+    void expect_equal(const char* name, const std::string& actual, const std::string& expected)
+    {
+        if (actual != expected)
+        {
+            ++g_failures;
+            std::fprintf(stderr, "FAIL %s: \"%s\", expected \"%s\"\n", name, actual.c_str(), expected.c_str());
+        }
+        else
+        {
+            std::fprintf(stderr, "ok   %s\n", name);
+        }
+    }
+} // namespace
+
+int main()
+{
+    FILE* sink = std::tmpfile();
+    if (!sink)
+        return 1;
+
+    dtlog::manual_clock clock(0);
+    dtlog::logger log("ho", "%L %N: %V\n");
+    log.set_clock(&clock);
+
+    expect_equal("format", dtlog::formatter::format("{0} {1} {2}", 1, 2.5, std::vector<int>{ 1, 2 }), "1 2.5 [1, 2]");
+
+    dtlog::format_buffer record;
+    log.format_record(dtlog::log_level::warning, "record", record);
+    expect_equal("format_record", record.str(), "warning ho: record\n");
+
+    dtlog::format_buffer printed;
+    dtlog::formatter::printf_to(printed, "%d-%s", 4, "x");
+    expect_equal("printf_to", printed.str(), "4-x");
+
+    expect_equal("second translation unit", format_in_second_unit(), "info second: 42\n");
+
+    // The writing paths, including the platform code that dtlog_ho.h inlines.
+    log.set_level_label(dtlog::log_level::info, "INFO");
+    log.log_to_file(sink, "to file {0}\n", 1);
+    {
+        dtlog::logger::batch records(log, sink);
+        records.info("batch {0}", 1);
+        records.error("batch {0}", 2);
+    }
+    DTLOG_LOG(log, dtlog::log_level::error, "call site {0}", 3);
+    {
+        dtlog::trace_sink trace(sink);
+        log.set_trace_sink(&trace);
+        dtlog::scoped_timer timer(log, std::chrono::hours(1), "timed");
+        log.set_trace_sink(nullptr);
+    }
+    expect_equal("stats", std::to_string(log.stats().total_records()), "4");
+
+    dtlog::page_resource pages(false, false);
+    void* block = pages.allocate(100, 8);
+    pages.deallocate(block, 100, 8);
+
+    std::fclose(sink);
+    return g_failures == 0 ? 0 : 1;
+}